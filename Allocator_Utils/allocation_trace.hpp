@@ -0,0 +1,366 @@
+#ifndef ALLOCATION_TRACE_HPP
+#define ALLOCATION_TRACE_HPP
+
+
+/*
+ *  Allocation trace recording shared by all the allocators, so that the allocation traffic of a real program
+ *  can be replayed offline against every allocator with trace_replay. The hooks are compiled in only when
+ *  ALLOCATOR_TRACE is defined, otherwise they are empty and cost nothing. While an allocation_trace is open,
+ *  the hooks of every allocator append fixed size records to the file it maps, from any thread without a lock.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/**
+ * @brief The trace_op enum
+ * allocate   - A block of size bytes aligned to 2^align_log2 was allocated at id.
+ * deallocate - The block at id was deallocated.
+ * resize     - The block at id was resized in place to size bytes.
+ * release    - Every block in [id, id + size) was released in bulk by a rewind or a reset.
+ */
+
+enum class trace_op : std::uint8_t{
+    allocate = 1,
+    deallocate = 2,
+    resize = 3,
+    release = 4
+};
+
+
+/**
+ * @brief The trace_record class
+ * One allocator operation. Blocks are identified by their address, which is unique while the block is live.
+ * Records are 32 bytes, two to a cache line, so a record never straddles two lines. The two records of a line
+ * may be written by different threads.
+ */
+struct trace_record{
+    std::uint64_t timestamp;    // Nanoseconds since the trace was opened
+    std::uint64_t id;           // Address of the block
+    std::uint64_t size;
+    std::uint32_t thread;       // Index of the recording thread, in the order threads first recorded
+    trace_op op;
+    std::uint8_t align_log2;
+    std::uint16_t reserved;
+};
+
+static_assert(sizeof(trace_record) == 32);
+
+
+/**
+ * @brief The trace_mode enum
+ * ring   - The file keeps the latest records, overwriting the oldest ones once it is full.
+ * linear - The file keeps the first records, later ones are dropped once it is full.
+ */
+
+enum class trace_mode : std::uint32_t{
+    ring,
+    linear
+};
+
+
+/**
+ * @brief The trace_header class
+ * Layout of the start of a trace file, the records follow it.
+ */
+struct trace_header{
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t capacity;     // Number of records the file holds
+    trace_mode mode;
+    std::uint32_t reserved;
+    std::uint64_t appended;     // Number of records appended so far, updated atomically
+    std::uint64_t padding[3];
+};
+
+static_assert(sizeof(trace_header) == 64);
+
+constexpr std::uint64_t trace_magic {0x43525443'4f4c4c41}; // "ALLOCTRC"
+constexpr std::uint32_t trace_version {1};
+
+
+/**
+ * @brief The allocation_trace class
+ * Creates or truncates the trace file at path with room for capacity records and maps it with MAP_SHARED.
+ * The trace is active from its construction to its destruction, only one trace can be active at a time. The
+ * records are written through the mapping, so they reach the file even if the process is killed; a record
+ * being written at that moment may be incomplete. The trace must outlive the allocator traffic it records,
+ * threads still allocating when it is destroyed may write to the unmapped file.
+ */
+
+class allocation_trace{
+
+    int fd {-1};
+    std::size_t mapped_bytes {0};
+    trace_header* header {nullptr};
+    trace_record* records {nullptr};
+    std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+
+    static std::atomic<allocation_trace*>& active() noexcept {
+        static std::atomic<allocation_trace*> trace {nullptr};
+        return trace;
+    }
+
+    static std::uint32_t thread_index() noexcept {
+        static std::atomic<std::uint32_t> threads {0};
+        thread_local const std::uint32_t index {threads.fetch_add(1, std::memory_order_relaxed)};
+        return index;
+    }
+
+public:
+
+    /**
+     * @brief allocation_trace Converting constructor
+     * @param path File the records are written to
+     * @param capacity Number of records the file holds
+     * @param mode Whether the oldest or the newest records are dropped once the file is full
+     */
+    allocation_trace(const char* path, std::size_t capacity, trace_mode mode = trace_mode::ring){
+        if(capacity == 0)
+            throw std::logic_error("Trace capacity must not be zero");
+        if(current() != nullptr)
+            throw std::logic_error("Another allocation trace is already active");
+
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0)
+            throw std::system_error(errno, std::generic_category(), "Cannot open trace file");
+
+        mapped_bytes = sizeof(trace_header) + capacity * sizeof(trace_record);
+        void* memory {MAP_FAILED};
+        if(ftruncate(fd, static_cast<off_t>(mapped_bytes)) == 0)
+            memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(memory == MAP_FAILED){
+            close(fd);
+            throw std::bad_alloc();
+        }
+
+        header = static_cast<trace_header*>(memory);
+        records = reinterpret_cast<trace_record*>(header + 1);
+        header->version = trace_version;
+        header->record_size = sizeof(trace_record);
+        header->capacity = capacity;
+        header->mode = mode;
+        header->appended = 0;
+        std::atomic_ref<std::uint64_t>(header->magic).store(trace_magic, std::memory_order_release);
+
+        allocation_trace* expected {nullptr};
+        if(!active().compare_exchange_strong(expected, this, std::memory_order_acq_rel)){
+            munmap(header, mapped_bytes);
+            close(fd);
+            throw std::logic_error("Another allocation trace is already active");
+        }
+    }
+
+    allocation_trace(const allocation_trace&) = delete;
+    allocation_trace& operator= (const allocation_trace&) = delete;
+
+    ~allocation_trace(){
+        active().store(nullptr, std::memory_order_release);
+        munmap(header, mapped_bytes);
+        close(fd);
+    }
+
+    /**
+     * @brief current
+     * @return The active trace or nullptr
+     */
+    static allocation_trace* current() noexcept {
+        return active().load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief append Appends a record, from any thread
+     * The slot is claimed with a single fetch_add, so records are ordered as their operations were: a block is
+     * always recorded as deallocated before another thread can be handed the same address.
+     * @param op Operation
+     * @param id Address of the block
+     * @param size Size of the block or of the released range
+     * @param align Alignment of the block, a power of two
+     */
+    void append(trace_op op, const void* id, std::size_t size, std::size_t align) noexcept {
+        const std::uint64_t index {std::atomic_ref<std::uint64_t>(header->appended).fetch_add(1, std::memory_order_acq_rel)};
+        if(header->mode == trace_mode::linear && index >= header->capacity)
+            return;
+
+        trace_record& rec {records[index % header->capacity]};
+        rec.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        rec.id = reinterpret_cast<std::uintptr_t>(id);
+        rec.size = size;
+        rec.thread = thread_index();
+        rec.op = op;
+        rec.align_log2 = static_cast<std::uint8_t>(std::countr_zero(align | std::size_t{1} << 63));
+        rec.reserved = 0;
+    }
+
+    /**
+     * @brief appended
+     * @return Number of records appended so far, including the ones which were overwritten or dropped
+     */
+    std::uint64_t appended() const noexcept {
+        return std::atomic_ref<std::uint64_t>(header->appended).load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief dropped
+     * @return Number of records which were overwritten (ring) or not stored (linear) because the file is full
+     */
+    std::uint64_t dropped() const noexcept {
+        const std::uint64_t count {appended()};
+        return count > header->capacity ? count - header->capacity : 0;
+    }
+
+    /**
+     * @brief sync Flushes the records written so far to the file
+     */
+    void sync() noexcept {
+        msync(header, mapped_bytes, MS_SYNC);
+    }
+};
+
+
+/**
+ * @brief read_trace Reads the records of a trace file in the order they were appended
+ * A ring trace which wrapped around yields its latest capacity records.
+ * @param path Trace file written by an allocation_trace
+ */
+inline std::vector<trace_record> read_trace(const char* path){
+    const int fd {open(path, O_RDONLY)};
+    if(fd < 0)
+        throw std::system_error(errno, std::generic_category(), "Cannot open trace file");
+
+    struct stat info{};
+    trace_header header{};
+    if(fstat(fd, &info) != 0 || pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+       header.magic != trace_magic || header.version != trace_version || header.record_size != sizeof(trace_record) ||
+       static_cast<std::uint64_t>(info.st_size) < sizeof(trace_header) + header.capacity * sizeof(trace_record)){
+        close(fd);
+        throw std::runtime_error(std::string{"Not an allocation trace: "} + path);
+    }
+
+    const std::uint64_t count {std::min(header.appended, header.capacity)};
+    const std::uint64_t first {header.mode == trace_mode::ring ? header.appended - count : 0};
+    std::vector<trace_record> records(count);
+    for(std::uint64_t i = 0; i < count; ++i){
+        const off_t offset {static_cast<off_t>(sizeof(trace_header) + (first + i) % header.capacity * sizeof(trace_record))};
+        if(pread(fd, &records[i], sizeof(trace_record), offset) != static_cast<ssize_t>(sizeof(trace_record))){
+            close(fd);
+            throw std::runtime_error(std::string{"Truncated allocation trace: "} + path);
+        }
+    }
+    close(fd);
+    return records;
+}
+
+
+#ifdef ALLOCATOR_TRACE
+
+/**
+ * @brief The trace_suppression class
+ * Suppresses the hooks of the calling thread while it exists. An allocator built on top of other allocators
+ * holds it around their calls and records the request itself, so that a block is recorded only once.
+ */
+class trace_suppression{
+
+    static bool& flag() noexcept {
+        thread_local bool suppressed {false};
+        return suppressed;
+    }
+
+    bool previous {flag()};
+
+public:
+    trace_suppression() noexcept {
+        flag() = true;
+    }
+
+    trace_suppression(const trace_suppression&) = delete;
+    trace_suppression& operator= (const trace_suppression&) = delete;
+
+    ~trace_suppression(){
+        flag() = previous;
+    }
+
+    /**
+     * @brief engaged
+     * @return true if the hooks of the calling thread are suppressed
+     */
+    static bool engaged() noexcept {
+        return flag();
+    }
+};
+
+/**
+ * @brief trace_allocation Records an allocation in the active trace
+ * @param ptr Address of the block, nothing is recorded for nullptr
+ * @param size Number of bytes requested
+ * @param align Alignment requested
+ */
+inline void trace_allocation(const void* ptr, std::size_t size, std::size_t align) noexcept {
+    if(allocation_trace* trace {allocation_trace::current()}; trace && ptr && !trace_suppression::engaged())
+        trace->append(trace_op::allocate, ptr, size, align);
+}
+
+/**
+ * @brief trace_deallocation Records a deallocation in the active trace
+ * Concurrent allocators call it before the block is handed back, so that it is ordered before the next
+ * allocation of the same address.
+ */
+inline void trace_deallocation(const void* ptr) noexcept {
+    if(allocation_trace* trace {allocation_trace::current()}; trace && !trace_suppression::engaged())
+        trace->append(trace_op::deallocate, ptr, 0, 1);
+}
+
+/**
+ * @brief trace_resize Records a block resized in place to size bytes
+ */
+inline void trace_resize(const void* ptr, std::size_t size) noexcept {
+    if(allocation_trace* trace {allocation_trace::current()}; trace && !trace_suppression::engaged())
+        trace->append(trace_op::resize, ptr, size, 1);
+}
+
+/**
+ * @brief trace_release Records the bulk release of every block in [begin, end)
+ */
+inline void trace_release(const void* begin, const void* end) noexcept {
+    if(allocation_trace* trace {allocation_trace::current()}; trace && begin < end && !trace_suppression::engaged())
+        trace->append(trace_op::release, begin, static_cast<std::size_t>(static_cast<const std::byte*>(end) - static_cast<const std::byte*>(begin)), 1);
+}
+
+#else
+
+/**
+ * @brief The trace_suppression class
+ * Tracing is disabled, there is nothing to suppress.
+ */
+class trace_suppression{
+public:
+    trace_suppression() noexcept {}
+};
+
+inline void trace_allocation(const void*, std::size_t, std::size_t) noexcept {}
+inline void trace_deallocation(const void*) noexcept {}
+inline void trace_resize(const void*, std::size_t) noexcept {}
+inline void trace_release(const void*, const void*) noexcept {}
+
+#endif // ALLOCATOR_TRACE
+
+
+#endif // ALLOCATION_TRACE_HPP
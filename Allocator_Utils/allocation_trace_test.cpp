@@ -0,0 +1,156 @@
+#include "allocation_trace.hpp"
+#include "concurrent_pool_allocator.hpp"
+#include "heap_buffer_arena.hpp"
+#include "pool_allocator.hpp"
+#include "small_object_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <set>
+#include <thread>
+#include <vector>
+
+#ifndef ALLOCATOR_TRACE
+#error "allocation_trace_test must be built with ALLOCATOR_TRACE"
+#endif
+
+static bool is_record(const trace_record& rec, trace_op op, const void* ptr, std::size_t size){
+    return rec.op == op && rec.id == reinterpret_cast<std::uintptr_t>(ptr) && rec.size == size;
+}
+
+int main(){
+
+    char path[] {"/tmp/allocation_trace_testXXXXXX"};
+    const int temp {mkstemp(path)};
+    CHECK(temp >= 0);
+    close(temp);
+
+    {
+        // Every operation of the allocators is recorded once, in order
+        pool_allocator<64, 16> pool(4096);
+        heap_arena ar {4096};
+        small_object_allocator small;
+        std::byte* chunk {nullptr};
+        std::byte* block {nullptr};
+        std::byte* object {nullptr};
+        std::byte* bumped {nullptr};
+        {
+            allocation_trace trace(path, 64, trace_mode::linear);
+            CHECK(allocation_trace::current() == &trace);
+            chunk = pool.allocate();
+            pool.deallocate(chunk);
+            const arena_marker marker {ar.get_marker()};
+            block = ar.allocate(100, 32);
+            CHECK(ar.try_expand(block, 150));
+            ar.deallocate(block);
+            bumped = ar.bump_allocate(40);
+            ar.rewind(marker);
+            object = small.allocate(24, 8);
+            {
+                const trace_suppression nested;
+                small.deallocate(object, 24, 8);
+            }
+            CHECK(trace.appended() == 8);
+            CHECK(trace.dropped() == 0);
+
+            // Only one trace is active at a time
+            bool refused {false};
+            try{
+                allocation_trace second(path, 8);
+            }
+            catch(const std::logic_error&){
+                refused = true;
+            }
+            CHECK(refused);
+        }
+        CHECK(allocation_trace::current() == nullptr);
+
+        // Without an active trace the hooks do nothing
+        pool.deallocate(pool.allocate());
+
+        const std::vector<trace_record> records {read_trace(path)};
+        CHECK(records.size() == 8);
+        if(records.size() == 8){
+            CHECK(is_record(records[0], trace_op::allocate, chunk, 64) && records[0].align_log2 == 4);
+            CHECK(is_record(records[1], trace_op::deallocate, chunk, 0));
+            CHECK(is_record(records[2], trace_op::allocate, block, 100) && records[2].align_log2 == 5);
+            CHECK(is_record(records[3], trace_op::resize, block, 150));
+            CHECK(is_record(records[4], trace_op::deallocate, block, 0));
+            CHECK(is_record(records[5], trace_op::allocate, bumped, 40));
+            CHECK(records[6].op == trace_op::release && records[6].id <= reinterpret_cast<std::uintptr_t>(bumped) &&
+                  records[6].id + records[6].size > reinterpret_cast<std::uintptr_t>(bumped));
+            CHECK(is_record(records[7], trace_op::allocate, object, 24) && records[7].align_log2 == 3);
+            for(std::size_t i = 1; i < records.size(); ++i)
+                CHECK(records[i].timestamp >= records[i - 1].timestamp);
+        }
+    }
+
+    {
+        // A ring keeps the latest records
+        pool_allocator<32, 8> pool(4096);
+        std::vector<std::byte*> chunks;
+        {
+            allocation_trace trace(path, 8);
+            for(int i = 0; i < 20; ++i)
+                chunks.push_back(pool.allocate());
+            CHECK(trace.dropped() == 12);
+        }
+        const std::vector<trace_record> records {read_trace(path)};
+        CHECK(records.size() == 8);
+        for(std::size_t i = 0; i < records.size(); ++i)
+            CHECK(is_record(records[i], trace_op::allocate, chunks[12 + i], 32));
+    }
+
+    {
+        // A rejected deallocation is not recorded
+        concurrent_pool_allocator<32, 8> pool(4096);
+        std::byte foreign[32];
+        allocation_trace trace(path, 8);
+        bool rejected {false};
+        try{
+            pool.deallocate(foreign);
+        }
+        catch(const std::logic_error&){
+            rejected = true;
+        }
+        CHECK(rejected);
+        CHECK(trace.appended() == 0);
+    }
+
+    {
+        // Concurrent allocations and deallocations are recorded in an order which replays
+        constexpr std::size_t threads {4};
+        constexpr std::size_t rounds {20000};
+        concurrent_pool_allocator<32, 8> pool(64 * 32);
+        {
+            allocation_trace trace(path, threads * rounds * 2, trace_mode::linear);
+            std::vector<std::thread> workers;
+            for(std::size_t t = 0; t < threads; ++t){
+                workers.emplace_back([&]{
+                    for(std::size_t i = 0; i < rounds; ++i){
+                        if(std::byte* chunk = pool.allocate())
+                            pool.deallocate(chunk);
+                    }
+                });
+            }
+            for(std::thread& worker : workers)
+                worker.join();
+        }
+        const std::vector<trace_record> records {read_trace(path)};
+        std::set<std::uint64_t> live;
+        std::set<std::uint32_t> recorders;
+        bool consistent {true};
+        for(const trace_record& rec : records){
+            recorders.insert(rec.thread);
+            if(rec.op == trace_op::allocate)
+                consistent &= live.insert(rec.id).second;
+            else
+                consistent &= live.erase(rec.id) == 1;
+        }
+        CHECK(consistent);
+        CHECK(live.empty());
+        CHECK(recorders.size() == threads);
+    }
+
+    unlink(path);
+    return test::exit_code();
+}
@@ -0,0 +1,230 @@
+#ifndef ALLOCATOR_STATS_HPP
+#define ALLOCATOR_STATS_HPP
+
+
+/*
+ *  Allocation statistics shared by all the allocators. Statistics are compiled in only when ALLOCATOR_STATS
+ *  is defined, otherwise the recording functions are empty and the stats member of an allocator takes no
+ *  space, so there is no overhead at all. Allocators expose the collected statistics through get_stats(),
+ *  which returns an allocator_stats_snapshot.
+ */
+
+
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdio>
+
+/**
+ * @brief The allocator_stats_snapshot class
+ * Point-in-time copy of the statistics of an allocator.
+ * live_bytes and peak_live_bytes count the memory footprint of live blocks, including headers and padding.
+ * padding_bytes is the total number of bytes lost to headers and alignment by all allocations so far.
+ * fragmentation is 1 - (largest free block / free bytes), 0 when free memory is contiguous.
+ * size_histogram counts allocations by requested size, bucket i holds sizes in [2^(i-1), 2^i), the last
+ * bucket holds every larger size.
+ */
+struct allocator_stats_snapshot{
+    constexpr static std::size_t histogram_buckets {16};
+
+    std::size_t allocations {0};
+    std::size_t deallocations {0};
+    std::size_t failed_allocations {0};
+    std::size_t live_bytes {0};
+    std::size_t peak_live_bytes {0};
+    std::size_t padding_bytes {0};
+    double fragmentation {0.0};
+    std::array<std::size_t, histogram_buckets> size_histogram {};
+};
+
+
+/**
+ * @brief fragmentation_ratio Computes the fragmentation reported in a snapshot
+ */
+constexpr double fragmentation_ratio(std::size_t largest_free, std::size_t free_bytes) noexcept {
+    return free_bytes ? 1.0 - static_cast<double>(largest_free) / static_cast<double>(free_bytes) : 0.0;
+}
+
+
+/**
+ * @brief write_stats_json Writes the snapshot as a single line JSON object, for periodic export
+ * @param out Output stream
+ * @param name Name identifying the allocator in the exported record
+ * @param snap Snapshot to write
+ */
+inline void write_stats_json(std::FILE* out, const char* name, const allocator_stats_snapshot& snap){
+    std::fprintf(out, "{\"allocator\":\"%s\",\"allocations\":%zu,\"deallocations\":%zu,\"failed_allocations\":%zu,"
+                      "\"live_bytes\":%zu,\"peak_live_bytes\":%zu,\"padding_bytes\":%zu,\"fragmentation\":%.4f,\"size_histogram\":[",
+                 name, snap.allocations, snap.deallocations, snap.failed_allocations,
+                 snap.live_bytes, snap.peak_live_bytes, snap.padding_bytes, snap.fragmentation);
+    for(std::size_t i = 0; i < snap.size_histogram.size(); ++i){
+        std::fprintf(out, i ? ",%zu" : "%zu", snap.size_histogram[i]);
+    }
+    std::fprintf(out, "]}\n");
+}
+
+
+#ifdef ALLOCATOR_STATS
+
+/**
+ * @brief The basic_allocator_stats class
+ * Statistics recorder. The counter type is std::size_t for single-threaded allocators and
+ * std::atomic<std::size_t> for allocators used concurrently.
+ */
+
+template<typename counter_type>
+class basic_allocator_stats{
+
+    counter_type allocations {0};
+    counter_type deallocations {0};
+    counter_type failed_allocations {0};
+    counter_type live_bytes {0};
+    counter_type peak_live_bytes {0};
+    counter_type padding_bytes {0};
+    std::array<counter_type, allocator_stats_snapshot::histogram_buckets> size_histogram {};
+
+private:
+
+    static std::size_t add(std::size_t& counter, std::size_t value) noexcept {
+        return counter += value;
+    }
+
+    static std::size_t add(std::atomic<std::size_t>& counter, std::size_t value) noexcept {
+        return counter.fetch_add(value, std::memory_order_relaxed) + value;
+    }
+
+    static void sub(std::size_t& counter, std::size_t value) noexcept {
+        counter -= value;
+    }
+
+    static void sub(std::atomic<std::size_t>& counter, std::size_t value) noexcept {
+        counter.fetch_sub(value, std::memory_order_relaxed);
+    }
+
+    static void update_max(std::size_t& counter, std::size_t value) noexcept {
+        if(value > counter)
+            counter = value;
+    }
+
+    static void update_max(std::atomic<std::size_t>& counter, std::size_t value) noexcept {
+        std::size_t curr {counter.load(std::memory_order_relaxed)};
+        while(value > curr && !counter.compare_exchange_weak(curr, value, std::memory_order_relaxed)){}
+    }
+
+    static std::size_t load(const std::size_t& counter) noexcept {
+        return counter;
+    }
+
+    static std::size_t load(const std::atomic<std::size_t>& counter) noexcept {
+        return counter.load(std::memory_order_relaxed);
+    }
+
+    static std::size_t bucket_of(std::size_t size) noexcept {
+        const std::size_t bucket {static_cast<std::size_t>(std::bit_width(size))};
+        return bucket < allocator_stats_snapshot::histogram_buckets ? bucket : allocator_stats_snapshot::histogram_buckets - 1;
+    }
+
+public:
+
+    /**
+     * @brief record_allocation Records a successful allocation
+     * @param requested Number of bytes requested by the user
+     * @param footprint Number of bytes the allocation actually uses, including headers and padding
+     */
+    void record_allocation(std::size_t requested, std::size_t footprint) noexcept {
+        add(allocations, 1);
+        add(padding_bytes, footprint - requested);
+        add(size_histogram[bucket_of(requested)], 1);
+        update_max(peak_live_bytes, add(live_bytes, footprint));
+    }
+
+    /**
+     * @brief record_overhead Records bytes used by the allocator's own bookkeeping inside its memory
+     */
+    void record_overhead(std::size_t footprint) noexcept {
+        add(padding_bytes, footprint);
+        update_max(peak_live_bytes, add(live_bytes, footprint));
+    }
+
+    /**
+     * @brief record_deallocation Records a deallocation
+     * @param footprint Number of bytes the block used
+     */
+    void record_deallocation(std::size_t footprint) noexcept {
+        add(deallocations, 1);
+        sub(live_bytes, footprint);
+    }
+
+    /**
+     * @brief record_resize Records a block resized in place
+     * @param old_footprint Number of bytes the block used before
+     * @param new_footprint Number of bytes the block uses now
+     */
+    void record_resize(std::size_t old_footprint, std::size_t new_footprint) noexcept {
+        if(new_footprint > old_footprint)
+            update_max(peak_live_bytes, add(live_bytes, new_footprint - old_footprint));
+        else
+            sub(live_bytes, old_footprint - new_footprint);
+    }
+
+    /**
+     * @brief record_release Records memory released in bulk (rewind, reset) without individual deallocations
+     */
+    void record_release(std::size_t footprint) noexcept {
+        sub(live_bytes, footprint);
+    }
+
+    /**
+     * @brief record_failure Records an allocation which could not be served
+     */
+    void record_failure() noexcept {
+        add(failed_allocations, 1);
+    }
+
+    /**
+     * @brief snapshot Copies the statistics
+     * @param fragmentation Fragmentation ratio computed by the allocator
+     */
+    allocator_stats_snapshot snapshot(double fragmentation = 0.0) const noexcept {
+        allocator_stats_snapshot snap;
+        snap.allocations = load(allocations);
+        snap.deallocations = load(deallocations);
+        snap.failed_allocations = load(failed_allocations);
+        snap.live_bytes = load(live_bytes);
+        snap.peak_live_bytes = load(peak_live_bytes);
+        snap.padding_bytes = load(padding_bytes);
+        snap.fragmentation = fragmentation;
+        for(std::size_t i = 0; i < snap.size_histogram.size(); ++i){
+            snap.size_histogram[i] = load(size_histogram[i]);
+        }
+        return snap;
+    }
+};
+
+using allocator_stats = basic_allocator_stats<std::size_t>;
+using concurrent_allocator_stats = basic_allocator_stats<std::atomic<std::size_t>>;
+
+#else
+
+/**
+ * @brief The allocator_stats class
+ * Statistics are disabled, every recording function compiles to nothing.
+ */
+class allocator_stats{
+public:
+    void record_allocation(std::size_t, std::size_t) noexcept {}
+    void record_overhead(std::size_t) noexcept {}
+    void record_deallocation(std::size_t) noexcept {}
+    void record_resize(std::size_t, std::size_t) noexcept {}
+    void record_release(std::size_t) noexcept {}
+    void record_failure() noexcept {}
+};
+
+using concurrent_allocator_stats = allocator_stats;
+
+#endif // ALLOCATOR_STATS
+
+
+#endif // ALLOCATOR_STATS_HPP
@@ -0,0 +1,101 @@
+#include "static_buffer_arena.hpp"
+#include "pool_allocator.hpp"
+#include "slab_pool_allocator.hpp"
+#include "small_object_allocator.hpp"
+#include "linear_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <new>
+
+#ifndef ALLOCATOR_STATS
+#error "allocator_stats_test must be built with ALLOCATOR_STATS"
+#endif
+
+int main(){
+
+    {
+        static arena<4096> ar;
+        std::byte* blocks[8];
+        for(std::size_t i = 0; i < 8; ++i){
+            blocks[i] = ar.allocate(20 + i * 30, 8);
+        }
+        ar.deallocate(blocks[1]);
+        ar.deallocate(blocks[4]);
+        ar.deallocate(blocks[5]);
+        try{
+            [[maybe_unused]] std::byte* too_big {ar.allocate(8192)};
+        }
+        catch(const std::bad_alloc&){}
+
+        const allocator_stats_snapshot snap {ar.get_stats()};
+        write_stats_json(stdout, "arena", snap);
+        CHECK(snap.allocations == 8);
+        CHECK(snap.deallocations == 3);
+        CHECK(snap.failed_allocations == 1);
+        CHECK(snap.live_bytes > 0 && snap.peak_live_bytes >= snap.live_bytes);
+        CHECK(snap.fragmentation > 0.0);
+    }
+
+    {
+        static arena<4096> ar;
+        linear_contiguous_allocator<4096, linear_mode::monotonic> scratch {ar};
+        {
+            scratch_scope frame {scratch};
+            [[maybe_unused]] std::byte* first {scratch.allocate(100, 1)};
+            [[maybe_unused]] std::byte* second {scratch.allocate(100, 64)};
+        }
+        const allocator_stats_snapshot snap {scratch.get_stats()};
+        write_stats_json(stdout, "linear_contiguous_allocator", snap);
+        CHECK(snap.allocations == 2);
+        CHECK(snap.live_bytes == 0);
+        CHECK(snap.padding_bytes > 0);
+    }
+
+    {
+        pool_allocator<32, 8> pool(32 * 4);
+        std::byte* chunks[5];
+        for(auto& chunk : chunks){
+            chunk = pool.allocate();
+        }
+        for(auto chunk : chunks){
+            if(chunk)
+                pool.deallocate(chunk);
+        }
+        const allocator_stats_snapshot snap {pool.get_stats()};
+        write_stats_json(stdout, "pool_allocator", snap);
+        CHECK(snap.allocations == 4);
+        CHECK(snap.failed_allocations == 1);
+        CHECK(snap.peak_live_bytes == 4 * 32);
+        CHECK(snap.live_bytes == 0);
+    }
+
+    {
+        slab_pool_allocator<64, 8, fixed_slab_growth<4096>> slabs{0};
+        std::byte* chunks[200];
+        for(auto& chunk : chunks){
+            chunk = slabs.allocate();
+        }
+        for(std::size_t i = 0; i < 200; i += 2){
+            slabs.deallocate(chunks[i]);
+        }
+        const allocator_stats_snapshot snap {slabs.get_stats()};
+        write_stats_json(stdout, "slab_pool_allocator", snap);
+        CHECK(snap.live_bytes == 100 * 64);
+        CHECK(snap.fragmentation == 1.0);
+    }
+
+    {
+        small_object_allocator alloc;
+        std::byte* small {alloc.allocate(17)};
+        std::byte* large {alloc.allocate(10000)};
+        const allocator_stats_snapshot snap {alloc.get_stats()};
+        write_stats_json(stdout, "small_object_allocator", snap);
+        CHECK(snap.padding_bytes > 0);
+        CHECK(snap.size_histogram[5] == 1 && snap.size_histogram[14] == 1);
+        alloc.deallocate(small, 17);
+        alloc.deallocate(large, 10000);
+        CHECK(alloc.get_stats().live_bytes == 0);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,97 @@
+#ifndef BACKGROUND_TRIMMER_HPP
+#define BACKGROUND_TRIMMER_HPP
+
+
+/*
+ *  Background Trimmer periodically returns the free memory of an allocator to the operating system from a
+ *  thread of its own, so that a long-running process gives back the pages of a burst without the threads
+ *  doing the allocations having to call trim().
+ */
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+/**
+ * @brief The background_trimmer class
+ * Calls the trim function every interval until it is destroyed. The function returns the number of bytes it
+ * released, typically [&]{ return alloc.trim(); }. concurrent_arena::trim() may be called from any thread,
+ * for the single-threaded allocators the function has to take the lock which guards the allocator.
+ */
+
+class background_trimmer{
+
+    std::function<std::size_t()> trim;
+    std::chrono::milliseconds interval;
+    std::atomic<std::size_t> released {0};
+    std::atomic<std::size_t> runs {0};
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping {false};
+    std::thread worker;
+
+private:
+
+    void run(){
+        std::unique_lock lock {mutex};
+        while(!wake.wait_for(lock, interval, [this]{ return stopping; })){
+            lock.unlock();
+            released.fetch_add(trim(), std::memory_order_relaxed);
+            runs.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+    }
+
+public:
+
+    /**
+     * @brief background_trimmer Converting constructor
+     * Starts the thread, the first trim happens one interval later.
+     * @param _interval Time between two trims
+     * @param _trim Function releasing the free memory, returning the number of bytes released
+     */
+    background_trimmer(std::chrono::milliseconds _interval, std::function<std::size_t()> _trim) :
+        trim{std::move(_trim)},
+        interval{_interval},
+        worker{&background_trimmer::run, this} {}
+
+    background_trimmer(const background_trimmer&) = delete;
+    background_trimmer& operator= (const background_trimmer&) = delete;
+
+    /**
+     * @brief ~background_trimmer Stops the thread, waiting for a trim in progress to finish
+     */
+    ~background_trimmer(){
+        {
+            std::lock_guard lock {mutex};
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    /**
+     * @brief released_bytes
+     * @return Total number of bytes released so far
+     */
+    std::size_t released_bytes() const noexcept {
+        return released.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief trims
+     * @return Number of trims done so far
+     */
+    std::size_t trims() const noexcept {
+        return runs.load(std::memory_order_relaxed);
+    }
+};
+
+
+#endif // BACKGROUND_TRIMMER_HPP
@@ -0,0 +1,74 @@
+#ifndef CHUNK_INIT_HPP
+#define CHUNK_INIT_HPP
+
+
+/*
+ *  Initialization policy of the chunks handed out by the pool allocators. The policy is a template parameter
+ *  of the pools, so the default policy compiles down to no writes to the chunk at all apart from the free
+ *  list link which the pool itself stores in free chunks.
+ */
+
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+
+/**
+ * @brief The chunk_init enum
+ * none   - Chunks are handed out as they are, their contents are unspecified. This is the default.
+ * zero   - Chunks are zero-filled on allocation.
+ * poison - Debug policy. Chunks are filled with alloc_poison on allocation and with free_poison on
+ *          deallocation. A recycled chunk whose free_poison was overwritten while it sat on the free
+ *          list was written after being freed, allocating it throws std::logic_error("Use after free").
+ */
+
+enum class chunk_init{
+    none,
+    zero,
+    poison
+};
+
+constexpr unsigned char alloc_poison {0xCD};
+constexpr unsigned char free_poison {0xDD};
+
+
+/**
+ * @brief init_chunk Applies the initialization policy to a chunk being handed out
+ * @param chunk Starting address of the chunk
+ * @param bytes Usable size of the chunk
+ * @param recycled true if the chunk comes from the free list, false if it has never been handed out
+ * @param link_bytes Leading bytes of a recycled chunk overwritten by the free list link, they are not
+ * checked for free_poison
+ */
+template<chunk_init init>
+inline void init_chunk(void* chunk, std::size_t bytes, [[maybe_unused]] bool recycled, [[maybe_unused]] std::size_t link_bytes){
+    if constexpr (init == chunk_init::zero){
+        std::memset(chunk, 0, bytes);
+    }
+    else if constexpr (init == chunk_init::poison){
+        if(recycled){
+            const unsigned char* byte {static_cast<const unsigned char*>(chunk)};
+            for(std::size_t i = link_bytes; i < bytes; ++i){
+                if(byte[i] != free_poison)
+                    throw std::logic_error("Use after free");
+            }
+        }
+        std::memset(chunk, alloc_poison, bytes);
+    }
+}
+
+
+/**
+ * @brief release_chunk Applies the initialization policy to a chunk being returned to the pool, before
+ * the pool writes the free list link into it.
+ */
+template<chunk_init init>
+inline void release_chunk([[maybe_unused]] void* chunk, [[maybe_unused]] std::size_t bytes) noexcept {
+    if constexpr (init == chunk_init::poison){
+        std::memset(chunk, free_poison, bytes);
+    }
+}
+
+
+#endif // CHUNK_INIT_HPP
@@ -0,0 +1,83 @@
+#include "chunk_init.hpp"
+#include "pool_allocator.hpp"
+#include "concurrent_pool_allocator.hpp"
+#include "slab_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+static bool filled_with(const std::byte* ptr, std::size_t bytes, unsigned char value){
+    for(std::size_t i = 0; i < bytes; ++i){
+        if(std::to_integer<unsigned char>(ptr[i]) != value)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief check_policies Runs the same checks against every policy of a pool type
+ */
+template<template<chunk_init> typename Pool>
+void check_policies(const char* name){
+
+    {
+        // No writes beyond the free list link
+        Pool<chunk_init::none> pool;
+        std::byte* chunk {pool.allocate()};
+        std::memset(chunk, 0x5A, 64);
+        pool.deallocate(chunk);
+        CHECK(pool.allocate() == chunk);
+        CHECK(filled_with(chunk + sizeof(mem_chunk), 64 - sizeof(mem_chunk), 0x5A));
+    }
+
+    {
+        Pool<chunk_init::zero> pool;
+        std::byte* chunk {pool.allocate()};
+        std::memset(chunk, 0x5A, 64);
+        pool.deallocate(chunk);
+        CHECK(pool.allocate() == chunk);
+        CHECK(filled_with(chunk, 64, 0));
+    }
+
+    {
+        Pool<chunk_init::poison> pool;
+        std::byte* chunk {pool.allocate()};
+        CHECK(filled_with(chunk, 64, alloc_poison));
+        pool.deallocate(chunk);
+        CHECK(filled_with(chunk + sizeof(mem_chunk), 64 - sizeof(mem_chunk), free_poison));
+
+        // Recycled chunks which were not touched are handed out again
+        CHECK(pool.allocate() == chunk);
+        pool.deallocate(chunk);
+
+        // Write after free is detected when the chunk is handed out again
+        chunk[40] = std::byte{1};
+        bool detected {false};
+        try{
+            [[maybe_unused]] std::byte* reused {pool.allocate()};
+        }
+        catch(const std::logic_error&){
+            detected = true;
+        }
+        CHECK(detected);
+    }
+
+    std::printf("%s chunk initialization policies checked\n", name);
+}
+
+template<chunk_init init>
+using pool = pool_allocator<64, 8, free_order::lifo, init>;
+
+template<chunk_init init>
+using concurrent_pool = concurrent_pool_allocator<64, 8, init>;
+
+template<chunk_init init>
+using slab_pool = slab_pool_allocator<64, 8, fixed_slab_growth<4096>, init>;
+
+int main(){
+    check_policies<pool>("pool_allocator");
+    check_policies<concurrent_pool>("concurrent_pool_allocator");
+    check_policies<slab_pool>("slab_pool_allocator");
+    return test::exit_code();
+}
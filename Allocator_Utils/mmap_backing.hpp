@@ -0,0 +1,235 @@
+#ifndef MMAP_BACKING_HPP
+#define MMAP_BACKING_HPP
+
+
+/*
+ *  Backing policy for the allocators which map their memory from the operating system. The policy selects the
+ *  page size of the mapping, whether its pages are faulted in up front and the NUMA node the memory is bound to.
+ *  Linux only, NUMA binding is done through the mbind system call so libnuma is not required.
+ */
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+#ifndef MADV_FREE
+#define MADV_FREE 8
+#endif
+
+
+/**
+ * @brief The page_policy enum
+ * standard         - Pages of the system page size.
+ * transparent_huge - The mapping is aligned to the huge page size and advised with MADV_HUGEPAGE, the kernel
+ *                    backs it with transparent huge pages when it can. This is only a hint, the mapping
+ *                    silently uses standard pages if transparent huge pages are disabled.
+ * explicit_huge    - The mapping is created with MAP_HUGETLB from the reserved huge page pool and its size
+ *                    is rounded up to the huge page size. Mapping fails if not enough huge pages are reserved
+ *                    (see /proc/sys/vm/nr_hugepages).
+ */
+
+enum class page_policy{
+    standard,
+    transparent_huge,
+    explicit_huge
+};
+
+
+/**
+ * @brief The mmap_backing class
+ * Options for mapping the memory of an allocator. The default is a plain private anonymous mapping.
+ * populate  - Pre-fault every page when the memory is mapped, so that the first touch of a chunk does not
+ *             take a page fault. For transparent huge pages and NUMA bound mappings the pages are faulted in
+ *             after the advice is applied, so that they are huge and on the requested node.
+ * numa_node - Bind the memory to this node with MPOL_BIND, -1 leaves the placement to the first touch policy.
+ */
+
+struct mmap_backing{
+    page_policy pages {page_policy::standard};
+    bool populate {false};
+    int numa_node {-1};
+};
+
+
+/**
+ * @brief The backing_region class
+ * Memory mapped by map_backing. bytes is the length of the mapping, which may be larger than requested,
+ * and must be passed to munmap. address is MAP_FAILED if the mapping failed.
+ */
+
+struct backing_region{
+    void* address {MAP_FAILED};
+    std::size_t bytes {0};
+};
+
+
+/**
+ * @brief huge_page_size Default huge page size of the system, read once from /proc/meminfo.
+ * @return Huge page size in bytes, 2 MiB if it cannot be determined
+ */
+inline std::size_t huge_page_size() noexcept {
+    static const std::size_t size {[]{
+        std::size_t kb {0};
+        if(std::FILE* meminfo = std::fopen("/proc/meminfo", "r")){
+            char line[128];
+            while(std::fgets(line, sizeof(line), meminfo)){
+                if(std::sscanf(line, "Hugepagesize: %zu kB", &kb) == 1)
+                    break;
+            }
+            std::fclose(meminfo);
+        }
+        return kb ? kb * 1024 : std::size_t{2} << 20;
+    }()};
+    return size;
+}
+
+
+/**
+ * @brief bind_to_node Binds the pages of the range to a single NUMA node
+ * @return true on success
+ */
+inline bool bind_to_node(void* addr, std::size_t bytes, int node) noexcept {
+    constexpr int mpol_bind {2};
+    constexpr unsigned mpol_mf_move {1u << 1};
+    constexpr std::size_t mask_bits {sizeof(unsigned long) * 8};
+    if(node < 0 || static_cast<std::size_t>(node) >= 16 * mask_bits)
+        return false;
+
+    unsigned long node_mask[16] {};
+    node_mask[node / mask_bits] = 1ul << (node % mask_bits);
+    return syscall(SYS_mbind, addr, bytes, mpol_bind, node_mask, 16 * mask_bits + 1, mpol_mf_move) == 0;
+}
+
+
+/**
+ * @brief prefault Faults in every page of the range for writing
+ */
+inline void prefault(void* addr, std::size_t bytes, std::size_t page_bytes) noexcept {
+    if(madvise(addr, bytes, MADV_POPULATE_WRITE) == 0)
+        return;
+    // Kernels older than 5.14, touch one byte of every page
+    volatile std::byte* page {static_cast<std::byte*>(addr)};
+    for(std::size_t offset = 0; offset < bytes; offset += page_bytes){
+        page[offset] = std::byte{0};
+    }
+}
+
+
+/**
+ * @brief map_backing Maps anonymous read-write memory according to the backing options
+ * @param bytes Minimum size of the mapping
+ * @param backing Backing options
+ * @param alignment Required alignment of the mapping, a power of two. Values up to the page size are
+ * always satisfied by mmap, larger alignments are obtained by over-reserving and trimming the mapping.
+ * @return The mapped region, or a region with address MAP_FAILED if the memory could not be mapped or
+ * could not be bound to the requested NUMA node.
+ */
+inline backing_region map_backing(std::size_t bytes, const mmap_backing& backing, std::size_t alignment = 0) noexcept {
+
+    const bool explicit_huge {backing.pages == page_policy::explicit_huge};
+    const std::size_t page_bytes {explicit_huge ? huge_page_size() : static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+    bytes = (bytes + page_bytes - 1) / page_bytes * page_bytes;
+
+    // Transparent huge pages are only used for huge page aligned ranges
+    if(backing.pages == page_policy::transparent_huge && bytes >= huge_page_size() && alignment < huge_page_size())
+        alignment = huge_page_size();
+
+    // Populate at mmap time only when no advice has to be applied first
+    const bool populate_on_map {backing.populate && backing.pages != page_policy::transparent_huge && backing.numa_node < 0};
+
+    int flags {MAP_PRIVATE | MAP_ANONYMOUS};
+    if(explicit_huge)
+        flags |= MAP_HUGETLB;
+    if(populate_on_map && alignment <= page_bytes)
+        flags |= MAP_POPULATE;
+
+    const std::size_t reserve {alignment > page_bytes ? bytes + alignment : bytes};
+    void* raw {mmap(nullptr, reserve, PROT_READ | PROT_WRITE, flags, -1, 0)};
+    if(raw == MAP_FAILED)
+        return {};
+
+    std::uintptr_t addr {reinterpret_cast<std::uintptr_t>(raw)};
+    if(reserve != bytes){
+        const std::uintptr_t aligned {(addr + alignment - 1) & ~(alignment - 1)};
+        if(aligned != addr)
+            munmap(raw, aligned - addr);
+        if(const std::size_t tail {addr + reserve - (aligned + bytes)}; tail)
+            munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+        addr = aligned;
+    }
+    void* region {reinterpret_cast<void*>(addr)};
+
+    if(backing.pages == page_policy::transparent_huge)
+        madvise(region, bytes, MADV_HUGEPAGE);
+
+    if(backing.numa_node >= 0 && !bind_to_node(region, bytes, backing.numa_node)){
+        munmap(region, bytes);
+        return {};
+    }
+
+    if(backing.populate && !(flags & MAP_POPULATE))
+        prefault(region, bytes, page_bytes);
+
+    return {region, bytes};
+}
+
+
+/**
+ * @brief The decommit_advice enum
+ * Selects how free memory is returned to the operating system by the trim() members of the allocators.
+ * dont_need - MADV_DONTNEED, the pages are dropped at once and read back as zeros. RSS drops immediately.
+ * lazy_free - MADV_FREE, the pages are only reclaimed when the system runs short of memory and keep their
+ *             contents until then, which is cheaper if the memory is reused soon. RSS only drops once the
+ *             pages are reclaimed. Memory which does not support MADV_FREE is released with MADV_DONTNEED.
+ */
+
+enum class decommit_advice{
+    dont_need,
+    lazy_free
+};
+
+
+/**
+ * @brief decommit Returns the whole pages inside [begin, end) to the operating system
+ * The contents of the pages are lost, the bytes of the partial pages at either end are kept. Pages which
+ * are not resident are counted out with mincore, so memory that was never touched or was already released
+ * is not reported again.
+ * @return Number of resident bytes released, 0 if the range holds no whole page or cannot be advised
+ */
+inline std::size_t decommit(void* begin, void* end, decommit_advice advice) noexcept {
+    const std::uintptr_t page {static_cast<std::uintptr_t>(sysconf(_SC_PAGE_SIZE))};
+    const std::uintptr_t first {(reinterpret_cast<std::uintptr_t>(begin) + page - 1) & ~(page - 1)};
+    const std::uintptr_t last {reinterpret_cast<std::uintptr_t>(end) & ~(page - 1)};
+    if(first >= last)
+        return 0;
+
+    std::size_t resident {0};
+    unsigned char residency[4096];
+    for(std::uintptr_t addr = first; addr < last;){
+        const std::size_t pages {std::min<std::size_t>((last - addr) / page, sizeof(residency))};
+        if(mincore(reinterpret_cast<void*>(addr), pages * page, residency) != 0)
+            return 0;
+        resident += static_cast<std::size_t>(std::count_if(residency, residency + pages, [](unsigned char state){ return state & 1; }));
+        addr += pages * page;
+    }
+    if(resident == 0)
+        return 0;
+
+    void* addr {reinterpret_cast<void*>(first)};
+    const std::size_t bytes {static_cast<std::size_t>(last - first)};
+    if(advice == decommit_advice::lazy_free && madvise(addr, bytes, MADV_FREE) == 0)
+        return resident * page;
+    return madvise(addr, bytes, MADV_DONTNEED) == 0 ? resident * page : 0;
+}
+
+
+#endif // MMAP_BACKING_HPP
@@ -0,0 +1,78 @@
+#include "mmap_backing.hpp"
+#include "pool_allocator.hpp"
+#include "concurrent_pool_allocator.hpp"
+#include "slab_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+int main(){
+
+    const std::size_t page {static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+
+    {
+        // Populated mappings are resident before they are touched
+        backing_region lazy {map_backing(64 * page, mmap_backing{})};
+        backing_region eager {map_backing(64 * page, mmap_backing{page_policy::standard, true, -1})};
+        CHECK(lazy.address != MAP_FAILED && eager.address != MAP_FAILED);
+        CHECK(test::resident_pages(lazy.address, static_cast<std::byte*>(lazy.address) + lazy.bytes) == 0);
+        CHECK(test::resident_pages(eager.address, static_cast<std::byte*>(eager.address) + eager.bytes) == 64);
+        munmap(lazy.address, lazy.bytes);
+        munmap(eager.address, eager.bytes);
+    }
+
+    {
+        // Transparent huge page mappings are huge page aligned
+        backing_region region {map_backing(huge_page_size() * 2, mmap_backing{page_policy::transparent_huge, true, -1})};
+        CHECK(region.address != MAP_FAILED);
+        CHECK(reinterpret_cast<std::uintptr_t>(region.address) % huge_page_size() == 0);
+        std::printf("Transparent huge page region of %zu bytes at %p\n", region.bytes, region.address);
+        munmap(region.address, region.bytes);
+    }
+
+    {
+        // Explicit huge pages depend on the reserved pool, the mapping may legitimately fail
+        try{
+            pool_allocator<64, 64> pool(page, mmap_backing{page_policy::explicit_huge, false, -1});
+            std::byte* chunk {pool.allocate()};
+            CHECK(chunk != nullptr);
+            pool.deallocate(chunk);
+            std::printf("Explicit huge pages available, pool holds %zu chunks\n", pool.available_chunks());
+        }
+        catch(const std::bad_alloc&){
+            std::printf("Explicit huge pages not reserved, skipping\n");
+        }
+    }
+
+    {
+        // Node 0 exists on every NUMA kernel, binding fails only without NUMA support
+        try{
+            concurrent_pool_allocator<64, 64> pool(huge_page_size(), mmap_backing{page_policy::transparent_huge, true, 0});
+            CHECK(pool.available_chunks() == huge_page_size() / 64);
+            std::byte* chunk {pool.allocate()};
+            CHECK(chunk != nullptr);
+            pool.deallocate(chunk);
+            std::printf("Pool bound to NUMA node 0\n");
+        }
+        catch(const std::bad_alloc&){
+            std::printf("NUMA binding not supported, skipping\n");
+        }
+    }
+
+    {
+        slab_pool_allocator<64, 8, fixed_slab_growth<(1 << 16)>> slabs(0, mmap_backing{page_policy::explicit_huge, true, -1});
+        std::byte* chunks[2048];
+        for(auto& chunk : chunks){
+            chunk = slabs.allocate();
+            CHECK(chunk != nullptr);
+        }
+        std::printf("Slab pool mapped %zu slabs\n", slabs.mapped_slabs());
+        for(auto chunk : chunks)
+            slabs.deallocate(chunk);
+        CHECK(slabs.mapped_slabs() == 0);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,53 @@
+#ifndef TEST_COMMON_HPP
+#define TEST_COMMON_HPP
+
+
+/*
+ *  Helpers shared by the test programs. A test counts its failed checks and exits with a non-zero status if
+ *  any of them failed, so that ctest reports it.
+ */
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+/**
+ * @brief CHECK Reports a failed condition and counts it, the test goes on
+ */
+#define CHECK(cond) do{ if(!(cond)){ std::printf("Check failed: %s (%s:%d)\n", #cond, __FILE__, __LINE__); ++test::failures; } }while(0)
+
+
+namespace test{
+
+    inline int failures {0};
+
+    /**
+     * @brief exit_code Status main returns, 1 if any check failed
+     */
+    inline int exit_code() noexcept {
+        return failures == 0 ? 0 : 1;
+    }
+
+    /**
+     * @brief resident_pages Number of whole pages of the range which are resident in memory
+     * At most 4096 pages from the start of the range are inspected.
+     */
+    inline std::size_t resident_pages(const void* begin, const void* end){
+        const std::uintptr_t page {static_cast<std::uintptr_t>(sysconf(_SC_PAGE_SIZE))};
+        const std::uintptr_t first {(reinterpret_cast<std::uintptr_t>(begin) + page - 1) & ~(page - 1)};
+        const std::uintptr_t last {reinterpret_cast<std::uintptr_t>(end) & ~(page - 1)};
+        unsigned char vec[4096];
+        const std::size_t pages {first < last ? std::min<std::size_t>((last - first) / page, sizeof(vec)) : 0};
+        if(pages == 0 || mincore(reinterpret_cast<void*>(first), pages * page, vec) != 0)
+            return 0;
+        return static_cast<std::size_t>(std::count_if(vec, vec + pages, [](unsigned char state){ return state & 1; }));
+    }
+}
+
+
+#endif // TEST_COMMON_HPP
@@ -0,0 +1,290 @@
+#include "benchmark_common.hpp"
+#include "pool_allocator.hpp"
+#include "static_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+#include "stack_allocator.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/*
+ *  Allocator benchmark suite. Runs pool_allocator, arena, linear_contiguous_allocator and stack_allocator
+ *  against glibc malloc on the standard allocation patterns:
+ *
+ *      lifo              - allocate a batch of blocks, free them in reverse order
+ *      fifo              - allocate a batch of blocks, free them in allocation order
+ *      random            - allocate a batch of blocks, free them in a random order
+ *      producer_consumer - sliding window queue, every step allocates one block and frees the oldest one
+ *      vector_growth     - a vector of ints growing by doubling, ops are push_backs
+ *      vector_growth_expand - the same, growing the block in place with try_expand() when the allocator can
+ *
+ *  Results are printed as one JSON object per line with ns/op, ops/s and peak RSS of the case. Every case
+ *  runs in its own process. Usage:
+ *
+ *      allocator_benchmark [--quick]
+ */
+
+namespace{
+
+    constexpr std::size_t max_block_size {256};
+    constexpr std::size_t arena_bytes {std::size_t{1} << 26};
+
+    struct workload{
+        std::size_t rounds;
+        std::size_t batch;
+        std::size_t window;
+        std::size_t vector_elements;
+    };
+
+    struct malloc_adapter{
+        constexpr static const char* name {"malloc"};
+        constexpr static bool fixed_size {false};
+
+        void* allocate(std::size_t size){
+            return std::malloc(size);
+        }
+
+        void deallocate(void* ptr, std::size_t){
+            std::free(ptr);
+        }
+    };
+
+    struct pool_adapter{
+        constexpr static const char* name {"pool_allocator"};
+        constexpr static bool fixed_size {true};
+
+        pool_allocator<max_block_size, 16> pool;
+
+        explicit pool_adapter(std::size_t max_live) : pool(max_live * max_block_size) {}
+
+        void* allocate(std::size_t){
+            return pool.allocate();
+        }
+
+        void deallocate(void* ptr, std::size_t){
+            pool.deallocate(static_cast<std::byte*>(ptr));
+        }
+    };
+
+    struct arena_adapter{
+        constexpr static const char* name {"arena"};
+        constexpr static bool fixed_size {false};
+
+        std::unique_ptr<arena<arena_bytes>> ar {new arena<arena_bytes>};
+
+        void* allocate(std::size_t size){
+            return ar->allocate(size);
+        }
+
+        void deallocate(void* ptr, std::size_t){
+            ar->deallocate(static_cast<std::byte*>(ptr));
+        }
+
+        bool try_expand(void* ptr, std::size_t size){
+            return ar->try_expand(static_cast<std::byte*>(ptr), size);
+        }
+    };
+
+    struct linear_adapter{
+        constexpr static const char* name {"linear_contiguous_allocator"};
+        constexpr static bool fixed_size {false};
+
+        std::unique_ptr<arena<arena_bytes>> ar {new arena<arena_bytes>};
+        linear_contiguous_allocator<arena_bytes> alloc {*ar};
+
+        void* allocate(std::size_t size){
+            return alloc.allocate(size);
+        }
+
+        void deallocate(void* ptr, std::size_t){
+            alloc.deallocate(static_cast<std::byte*>(ptr));
+        }
+
+        bool try_expand(void* ptr, std::size_t size){
+            return alloc.try_expand(static_cast<std::byte*>(ptr), size);
+        }
+    };
+
+    struct stack_adapter{
+        constexpr static const char* name {"stack_allocator"};
+        constexpr static bool fixed_size {false};
+
+        using unit_type = std::max_align_t;
+        stack_allocator<unit_type, arena_bytes / sizeof(unit_type)> alloc;
+
+        void* allocate(std::size_t size){
+            return alloc.allocate((size + sizeof(unit_type) - 1) / sizeof(unit_type));
+        }
+
+        void deallocate(void* ptr, std::size_t size){
+            alloc.deallocate(static_cast<unit_type*>(ptr), (size + sizeof(unit_type) - 1) / sizeof(unit_type));
+        }
+    };
+
+    template<typename Adapter>
+    void touch(void* ptr, std::size_t size){
+        std::memset(ptr, 0x5A, std::min<std::size_t>(size, 64));
+    }
+
+    enum class free_pattern{
+        lifo,
+        fifo,
+        random
+    };
+
+    template<typename Adapter>
+    bench::result batch_pattern(Adapter& alloc, const workload& wl, free_pattern pattern, const char* pattern_name){
+
+        std::mt19937 rng {12345};
+        std::uniform_int_distribution<std::size_t> size_dist {16, max_block_size};
+        std::vector<std::size_t> sizes(wl.batch);
+        std::generate(sizes.begin(), sizes.end(), [&](){ return size_dist(rng); });
+
+        std::vector<std::size_t> order(wl.batch);
+        std::iota(order.begin(), order.end(), 0);
+        if(pattern == free_pattern::lifo)
+            std::reverse(order.begin(), order.end());
+        else if(pattern == free_pattern::random)
+            std::shuffle(order.begin(), order.end(), rng);
+
+        std::vector<void*> blocks(wl.batch);
+
+        bench::timer tm;
+        for(std::size_t round = 0; round < wl.rounds; ++round){
+            for(std::size_t i = 0; i < wl.batch; ++i){
+                blocks[i] = alloc.allocate(sizes[i]);
+                touch<Adapter>(blocks[i], sizes[i]);
+            }
+            for(std::size_t i : order){
+                alloc.deallocate(blocks[i], sizes[i]);
+            }
+        }
+        const double seconds {tm.seconds()};
+        return bench::result{"allocator", Adapter::name, pattern_name, wl.rounds * wl.batch * 2, seconds};
+    }
+
+    template<typename Adapter>
+    bench::result producer_consumer(Adapter& alloc, const workload& wl){
+
+        std::mt19937 rng {54321};
+        std::uniform_int_distribution<std::size_t> size_dist {16, max_block_size};
+        const std::size_t steps {wl.rounds * wl.batch};
+        std::vector<std::size_t> sizes(wl.window);
+        std::generate(sizes.begin(), sizes.end(), [&](){ return size_dist(rng); });
+
+        std::vector<void*> queue(wl.window);
+
+        bench::timer tm;
+        for(std::size_t i = 0; i < wl.window; ++i){
+            queue[i] = alloc.allocate(sizes[i]);
+            touch<Adapter>(queue[i], sizes[i]);
+        }
+        for(std::size_t step = 0; step < steps; ++step){
+            const std::size_t slot {step % wl.window};
+            alloc.deallocate(queue[slot], sizes[slot]);
+            queue[slot] = alloc.allocate(sizes[slot]);
+            touch<Adapter>(queue[slot], sizes[slot]);
+        }
+        for(std::size_t i = 0; i < wl.window; ++i){
+            alloc.deallocate(queue[i], sizes[i]);
+        }
+        const double seconds {tm.seconds()};
+        return bench::result{"allocator", Adapter::name, "producer_consumer", (steps + wl.window) * 2, seconds};
+    }
+
+    template<typename Adapter>
+    concept expandable = requires(Adapter& alloc, void* ptr, std::size_t size){ alloc.try_expand(ptr, size); };
+
+    template<typename Adapter, bool in_place = false>
+    bench::result vector_growth(Adapter& alloc, const workload& wl){
+
+        bench::timer tm;
+        for(std::size_t round = 0; round < wl.rounds; ++round){
+            int* data {nullptr};
+            std::size_t capacity {0};
+            for(std::size_t i = 0; i < wl.vector_elements; ++i){
+                if(i == capacity){
+                    const std::size_t new_capacity {std::max<std::size_t>(16, capacity * 2)};
+                    if constexpr (in_place){
+                        if(data && alloc.try_expand(data, new_capacity * sizeof(int))){
+                            capacity = new_capacity;
+                            data[i] = static_cast<int>(i);
+                            continue;
+                        }
+                    }
+                    int* new_data {static_cast<int*>(alloc.allocate(new_capacity * sizeof(int)))};
+                    if(data){
+                        std::memcpy(new_data, data, capacity * sizeof(int));
+                        alloc.deallocate(data, capacity * sizeof(int));
+                    }
+                    data = new_data;
+                    capacity = new_capacity;
+                }
+                data[i] = static_cast<int>(i);
+            }
+            bench::do_not_optimize(data[wl.vector_elements / 2]);
+            alloc.deallocate(data, capacity * sizeof(int));
+        }
+        const double seconds {tm.seconds()};
+        return bench::result{"allocator", Adapter::name, in_place ? "vector_growth_expand" : "vector_growth", wl.rounds * wl.vector_elements, seconds};
+    }
+
+    template<typename Adapter, typename... Args>
+    bool run_suite(const workload& wl, Args&&... args){
+
+        bool ok {true};
+        const std::pair<free_pattern, const char*> batch_patterns[] {
+            {free_pattern::lifo, "lifo"}, {free_pattern::fifo, "fifo"}, {free_pattern::random, "random"}
+        };
+
+        for(const auto& [pattern, pattern_name] : batch_patterns){
+            ok &= bench::run_isolated([&, pattern = pattern, pattern_name = pattern_name](){
+                Adapter alloc {args...};
+                return batch_pattern(alloc, wl, pattern, pattern_name);
+            });
+        }
+
+        ok &= bench::run_isolated([&](){
+            Adapter alloc {args...};
+            return producer_consumer(alloc, wl);
+        });
+
+        if constexpr (Adapter::fixed_size){
+            bench::print_json(bench::result{"allocator", Adapter::name, "vector_growth", 0, 0, 0, false});
+        }
+        else{
+            ok &= bench::run_isolated([&](){
+                Adapter alloc {args...};
+                return vector_growth(alloc, wl);
+            });
+        }
+
+        if constexpr (expandable<Adapter>){
+            ok &= bench::run_isolated([&](){
+                Adapter alloc {args...};
+                return vector_growth<Adapter, true>(alloc, wl);
+            });
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char* argv[]){
+
+    const bool quick {argc > 1 && std::strcmp(argv[1], "--quick") == 0};
+    const workload wl {quick ? workload{10, 1000, 256, 10'000} : workload{200, 10'000, 4096, 1'000'000}};
+    const std::size_t max_live {std::max(wl.batch, wl.window)};
+
+    bool ok {true};
+    ok &= run_suite<malloc_adapter>(wl);
+    ok &= run_suite<pool_adapter>(wl, max_live);
+    ok &= run_suite<arena_adapter>(wl);
+    ok &= run_suite<linear_adapter>(wl);
+    ok &= run_suite<stack_adapter>(wl);
+
+    return ok ? 0 : 1;
+}
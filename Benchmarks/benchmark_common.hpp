@@ -0,0 +1,181 @@
+#ifndef BENCHMARK_COMMON_HPP
+#define BENCHMARK_COMMON_HPP
+
+
+/*
+ *  Helpers shared by the benchmark programs: timing, RSS measurement and machine-readable output.
+ *  Every benchmark case is run in a forked child process so that its peak resident set size is measured
+ *  in isolation from the other cases.
+ */
+
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace bench{
+
+    /**
+     * @brief The result class
+     * Outcome of a single benchmark case.
+     */
+    struct result{
+        std::string suite;
+        std::string allocator;
+        std::string pattern;
+        std::size_t ops {0};
+        double seconds {0};
+        long peak_rss_kb {0};
+        bool supported {true};
+        std::string fields {}; // Additional JSON members appended to the record, e.g. "\"dtlb_misses\":42"
+    };
+
+    /**
+     * @brief peak_rss_kb Peak resident set size of the calling process in kilobytes
+     */
+    inline long peak_rss_kb() noexcept {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    /**
+     * @brief current_rss_kb Current resident set size of the calling process in kilobytes
+     */
+    inline long current_rss_kb() noexcept {
+        long pages {0}, resident {0};
+        if(std::FILE* statm = std::fopen("/proc/self/statm", "r")){
+            if(std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+                resident = 0;
+            std::fclose(statm);
+        }
+        return resident * (sysconf(_SC_PAGE_SIZE) / 1024);
+    }
+
+    /**
+     * @brief do_not_optimize Prevents the compiler from discarding a computed value
+     */
+    template<typename T>
+    inline void do_not_optimize(const T& value) noexcept {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /**
+     * @brief timer Measures the wall clock time elapsed since its construction
+     */
+    class timer{
+        std::chrono::steady_clock::time_point start {std::chrono::steady_clock::now()};
+    public:
+        double seconds() const noexcept {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    /**
+     * @brief perf_counter Counts a hardware event of the calling thread with perf_event_open
+     * The counter is unavailable when the kernel does not allow it (perf_event_paranoid, containers, virtual
+     * machines without a PMU), read() then returns -1 and the benchmark still reports its timings.
+     */
+    class perf_counter{
+        int fd {-1};
+    public:
+        perf_counter(std::uint32_t type, std::uint64_t config) noexcept {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        perf_counter(const perf_counter&) = delete;
+        perf_counter& operator= (const perf_counter&) = delete;
+
+        ~perf_counter(){
+            if(fd >= 0)
+                close(fd);
+        }
+
+        bool available() const noexcept {
+            return fd >= 0;
+        }
+
+        void start() noexcept {
+            if(fd >= 0){
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        /**
+         * @brief stop Stops counting
+         * @return Number of events counted since start(), -1 if the counter is unavailable
+         */
+        long long stop() noexcept {
+            if(fd < 0)
+                return -1;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            long long count {0};
+            return read(fd, &count, sizeof(count)) == sizeof(count) ? count : -1;
+        }
+    };
+
+    /**
+     * @brief print_json Prints the result as a single line JSON object
+     */
+    inline void print_json(const result& res){
+        const double ns_per_op {res.ops ? res.seconds * 1e9 / static_cast<double>(res.ops) : 0.0};
+        const double ops_per_sec {res.seconds > 0 ? static_cast<double>(res.ops) / res.seconds : 0.0};
+        if(res.supported){
+            std::printf("{\"suite\":\"%s\",\"allocator\":\"%s\",\"pattern\":\"%s\",\"ops\":%zu,\"ns_per_op\":%.3f,\"ops_per_sec\":%.0f,\"peak_rss_kb\":%ld%s%s}\n",
+                        res.suite.c_str(), res.allocator.c_str(), res.pattern.c_str(), res.ops, ns_per_op, ops_per_sec, res.peak_rss_kb,
+                        res.fields.empty() ? "" : ",", res.fields.c_str());
+        }
+        else{
+            std::printf("{\"suite\":\"%s\",\"allocator\":\"%s\",\"pattern\":\"%s\",\"supported\":false}\n",
+                        res.suite.c_str(), res.allocator.c_str(), res.pattern.c_str());
+        }
+        std::fflush(stdout);
+    }
+
+    /**
+     * @brief run_isolated Runs the benchmark case in a child process and prints its result
+     * @param body Callable returning a result. Its peak_rss_kb is filled in by this function.
+     * @return false if the child process failed
+     */
+    template<typename Body>
+    bool run_isolated(Body&& body){
+        std::fflush(stdout);
+        const pid_t pid {fork()};
+        if(pid < 0)
+            return false;
+
+        if(pid == 0){
+            result res {body()};
+            res.peak_rss_kb = peak_rss_kb();
+            print_json(res);
+            std::_Exit(0);
+        }
+
+        int status {0};
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+}
+
+
+#endif // BENCHMARK_COMMON_HPP
@@ -0,0 +1,413 @@
+#include "allocation_trace.hpp"
+#include "benchmark_common.hpp"
+#include "concurrent_buffer_arena.hpp"
+#include "heap_buffer_arena.hpp"
+#include "pool_allocator.hpp"
+#include "small_object_allocator.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ *  Replays an allocation trace recorded with allocation_trace against the allocators of the repository, so
+ *  that the allocator of a program is chosen on its real traffic. Every allocator serves the recorded
+ *  operations in order and writes one byte per page of each block, as the program would have. The replay
+ *  reports the throughput, the peak footprint, which is the growth of the RSS during the replay, and the
+ *  fragmentation, the share of the peak footprint which does not hold live bytes at the peak. Without a trace
+ *  file a synthetic trace is recorded to trace_replay_sample.trace first. Usage:
+ *
+ *      trace_replay [--quick] [trace_file]
+ */
+
+enum class replay_kind : std::uint8_t{
+    allocate,
+    deallocate,
+    resize
+};
+
+struct replay_op{
+    std::uint64_t size;         // Size of the block after the operation
+    std::uint32_t slot;         // Index of the block in the table of live blocks
+    replay_kind kind;
+    std::uint8_t align_log2;
+};
+
+/**
+ * @brief The compiled_trace class
+ * Trace records turned into operations on a dense table of blocks, so that the replay does no lookups.
+ * Frees of blocks allocated before a ring trace starts are dropped, bulk releases become one free per block.
+ */
+struct compiled_trace{
+    std::vector<replay_op> ops;
+    std::size_t slots {0};
+    std::size_t peak_live_bytes {0};
+    std::size_t peak_live_blocks {0};
+    std::size_t peak_op {0};        // Index of the operation after which the live bytes peak
+    std::size_t common_size {0};    // 90th percentile of the allocation sizes
+};
+
+static compiled_trace compile(const std::vector<trace_record>& records){
+    compiled_trace trace;
+    std::map<std::uint64_t, std::uint32_t> live;    // Address of the block to its slot
+    std::vector<std::uint64_t> sizes;
+    std::vector<std::uint32_t> free_slots;
+    std::vector<std::uint64_t> allocation_sizes;
+    std::size_t live_bytes {0};
+
+    auto free_block {[&](std::map<std::uint64_t, std::uint32_t>::iterator block){
+        trace.ops.push_back(replay_op{sizes[block->second], block->second, replay_kind::deallocate, 0});
+        live_bytes -= sizes[block->second];
+        free_slots.push_back(block->second);
+        return live.erase(block);
+    }};
+
+    for(const trace_record& rec : records){
+        switch(rec.op){
+        case trace_op::allocate: {
+            // The address is reused, its free was lost to an untraced release
+            if(auto block {live.find(rec.id)}; block != live.end())
+                free_block(block);
+            std::uint32_t slot {static_cast<std::uint32_t>(sizes.size())};
+            if(free_slots.empty())
+                sizes.push_back(0);
+            else{
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            sizes[slot] = std::max<std::uint64_t>(rec.size, 1);
+            live.emplace(rec.id, slot);
+            live_bytes += sizes[slot];
+            allocation_sizes.push_back(sizes[slot]);
+            trace.ops.push_back(replay_op{sizes[slot], slot, replay_kind::allocate, rec.align_log2});
+            break;
+        }
+        case trace_op::deallocate:
+            if(auto block {live.find(rec.id)}; block != live.end())
+                free_block(block);
+            break;
+        case trace_op::resize:
+            if(auto block {live.find(rec.id)}; block != live.end()){
+                const std::uint32_t slot {block->second};
+                live_bytes = live_bytes - sizes[slot] + std::max<std::uint64_t>(rec.size, 1);
+                sizes[slot] = std::max<std::uint64_t>(rec.size, 1);
+                trace.ops.push_back(replay_op{sizes[slot], slot, replay_kind::resize, 0});
+            }
+            break;
+        case trace_op::release:
+            for(auto block {live.lower_bound(rec.id)}; block != live.end() && block->first < rec.id + rec.size;)
+                block = free_block(block);
+            break;
+        }
+        if(live_bytes > trace.peak_live_bytes){
+            trace.peak_live_bytes = live_bytes;
+            trace.peak_op = trace.ops.size() - 1;
+        }
+        trace.peak_live_blocks = std::max(trace.peak_live_blocks, live.size());
+    }
+
+    trace.slots = sizes.size();
+    if(!allocation_sizes.empty()){
+        auto percentile {allocation_sizes.begin() + static_cast<std::ptrdiff_t>(allocation_sizes.size() * 9 / 10)};
+        std::nth_element(allocation_sizes.begin(), percentile, allocation_sizes.end());
+        trace.common_size = *percentile;
+    }
+    return trace;
+}
+
+/**
+ * @brief touch Writes one byte to every page of the block
+ */
+static void touch(std::byte* ptr, std::size_t size) noexcept {
+    for(std::size_t offset = 0; offset < size; offset += 4096)
+        ptr[offset] = std::byte{1};
+    bench::do_not_optimize(ptr);
+}
+
+/**
+ * @brief move_block Moves the block to a new allocation of the target, the realloc fallback
+ */
+template<typename Target>
+static std::byte* move_block(Target& target, std::byte* ptr, std::size_t old_size, std::size_t size, std::size_t align){
+    std::byte* moved {target.allocate(size, align)};
+    if(moved){
+        std::memcpy(moved, ptr, std::min(old_size, size));
+        target.deallocate(ptr, old_size, align);
+    }
+    return moved;
+}
+
+struct malloc_target{
+    std::byte* allocate(std::size_t size, std::size_t align){
+        if(align <= alignof(std::max_align_t))
+            return static_cast<std::byte*>(std::malloc(size));
+        return static_cast<std::byte*>(std::aligned_alloc(align, (size + align - 1) / align * align));
+    }
+    void deallocate(std::byte* ptr, std::size_t, std::size_t){
+        std::free(ptr);
+    }
+    std::byte* resize(std::byte* ptr, std::size_t old_size, std::size_t size, std::size_t align){
+        if(align <= alignof(std::max_align_t))
+            return static_cast<std::byte*>(std::realloc(ptr, size));
+        return move_block(*this, ptr, old_size, size, align);
+    }
+};
+
+/**
+ * @brief The pool_target class
+ * Blocks which fit a chunk come from the pool, the others from malloc, as with pool_memory_resource.
+ */
+template<std::size_t chunk>
+struct pool_target{
+    pool_allocator<chunk, 16> pool;
+    malloc_target fallback;
+
+    explicit pool_target(std::size_t chunks) : pool(chunks * chunk) {}
+
+    std::byte* allocate(std::size_t size, std::size_t align){
+        if(size <= chunk && align <= 16){
+            if(std::byte* ptr {pool.allocate()})
+                return ptr;
+        }
+        return fallback.allocate(size, align);
+    }
+    void deallocate(std::byte* ptr, std::size_t size, std::size_t align){
+        if(pool.owns(ptr))
+            pool.deallocate(ptr);
+        else
+            fallback.deallocate(ptr, size, align);
+    }
+    std::byte* resize(std::byte* ptr, std::size_t old_size, std::size_t size, std::size_t align){
+        if(pool.owns(ptr) && size <= chunk)
+            return ptr;
+        return move_block(*this, ptr, old_size, size, align);
+    }
+};
+
+template<typename Arena>
+struct arena_target{
+    Arena ar;
+
+    template<typename... Args>
+    explicit arena_target(Args&&... args) : ar(std::forward<Args>(args)...) {}
+
+    std::byte* allocate(std::size_t size, std::size_t align){
+        try{
+            return ar.allocate(size, align);
+        }
+        catch(const std::bad_alloc&){
+            return nullptr;
+        }
+    }
+    void deallocate(std::byte* ptr, std::size_t, std::size_t){
+        ar.deallocate(ptr);
+    }
+    std::byte* resize(std::byte* ptr, std::size_t old_size, std::size_t size, std::size_t align){
+        if(size <= old_size){
+            ar.try_shrink(ptr, size);
+            return ptr;
+        }
+        if(ar.try_expand(ptr, size))
+            return ptr;
+        return move_block(*this, ptr, old_size, size, align);
+    }
+};
+
+struct small_object_target{
+    small_object_allocator alloc;
+
+    std::byte* allocate(std::size_t size, std::size_t align){
+        try{
+            return alloc.allocate(size, align);
+        }
+        catch(const std::bad_alloc&){
+            return nullptr;
+        }
+    }
+    void deallocate(std::byte* ptr, std::size_t size, std::size_t align){
+        alloc.deallocate(ptr, size, align);
+    }
+    std::byte* resize(std::byte* ptr, std::size_t old_size, std::size_t size, std::size_t align){
+        // The size class is found from the size, a block always moves to its new class
+        return size == old_size ? ptr : move_block(*this, ptr, old_size, size, align);
+    }
+};
+
+/**
+ * @brief replay Runs the compiled trace on the target
+ * The RSS is sampled 64 times over the replay and right after the live bytes peak, outside of the timing.
+ */
+template<typename Target>
+static bench::result replay(const char* allocator, const std::string& pattern, const compiled_trace& trace, Target& target){
+
+    std::vector<std::byte*> blocks(trace.slots, nullptr);
+    std::vector<std::uint64_t> sizes(trace.slots, 0);
+    std::vector<std::size_t> aligns(trace.slots, 1);
+    const long baseline_kb {bench::current_rss_kb()};
+    long peak_kb {baseline_kb};
+    std::size_t failed {0};
+    double seconds {0};
+    const std::size_t sample_every {std::max<std::size_t>(trace.ops.size() / 64, 1)};
+
+    bench::timer segment;
+    for(std::size_t i = 0; i < trace.ops.size(); ++i){
+        const replay_op& op {trace.ops[i]};
+        std::byte*& block {blocks[op.slot]};
+        switch(op.kind){
+        case replay_kind::allocate:
+            aligns[op.slot] = std::size_t{1} << op.align_log2;
+            sizes[op.slot] = op.size;
+            block = target.allocate(op.size, aligns[op.slot]);
+            if(block)
+                touch(block, op.size);
+            else
+                ++failed;
+            break;
+        case replay_kind::deallocate:
+            if(block)
+                target.deallocate(block, sizes[op.slot], aligns[op.slot]);
+            block = nullptr;
+            break;
+        case replay_kind::resize:
+            if(block){
+                std::byte* resized {target.resize(block, sizes[op.slot], op.size, aligns[op.slot])};
+                if(resized){
+                    if(op.size > sizes[op.slot])
+                        touch(resized + sizes[op.slot], op.size - sizes[op.slot]);
+                    block = resized;
+                    sizes[op.slot] = op.size;
+                }
+                else{
+                    ++failed;
+                }
+            }
+            break;
+        }
+        if(i == trace.peak_op || (i + 1) % sample_every == 0){
+            seconds += segment.seconds();
+            peak_kb = std::max(peak_kb, bench::current_rss_kb());
+            segment = bench::timer{};
+        }
+    }
+    seconds += segment.seconds();
+
+    for(std::size_t slot = 0; slot < blocks.size(); ++slot){
+        if(blocks[slot])
+            target.deallocate(blocks[slot], sizes[slot], aligns[slot]);
+    }
+
+    const long footprint_kb {std::max(peak_kb - baseline_kb, 1L)};
+    const double fragmentation {std::max(0.0, 1.0 - static_cast<double>(trace.peak_live_bytes) / 1024.0 / static_cast<double>(footprint_kb))};
+    char fields[160];
+    std::snprintf(fields, sizeof(fields), "\"peak_live_kb\":%zu,\"peak_footprint_kb\":%ld,\"fragmentation\":%.4f,\"failed\":%zu",
+                  trace.peak_live_bytes / 1024, footprint_kb, fragmentation, failed);
+    return bench::result{"trace_replay", allocator, pattern, trace.ops.size(), seconds, 0, true, fields};
+}
+
+/**
+ * @brief record_sample Records a synthetic trace: mostly small blocks with a few large ones, random lifetimes,
+ * some blocks grown or shrunk, and a working set which swings between bursts
+ */
+static void record_sample(const char* path, std::size_t ops){
+    allocation_trace trace(path, ops, trace_mode::linear);
+    std::mt19937_64 rng {7};
+    struct block{
+        std::uintptr_t id;
+        std::size_t size;
+    };
+    std::vector<block> live;
+    std::uintptr_t next_id {0x10000};
+    for(std::size_t i = 0; i < ops; ++i){
+        const std::size_t target {(i / 20000) % 2 ? std::size_t{2000} : std::size_t{20000}};
+        const std::uint64_t dice {rng() % 100};
+        if(live.empty() || (live.size() < target && dice < 60)){
+            const std::uint64_t kind {rng() % 100};
+            const std::size_t size {kind < 70 ? 16 + rng() % 241 : kind < 95 ? 257 + rng() % 3840 : 4097 + rng() % 61440};
+            const std::size_t align {rng() % 20 ? std::size_t{16} : std::size_t{64}};
+            live.push_back(block{next_id, size});
+            trace.append(trace_op::allocate, reinterpret_cast<const void*>(next_id), size, align);
+            next_id += (size + 4095) / 4096 * 4096;
+        }
+        else if(dice < 95){
+            const std::size_t victim {static_cast<std::size_t>(rng() % live.size())};
+            trace.append(trace_op::deallocate, reinterpret_cast<const void*>(live[victim].id), 0, 1);
+            live[victim] = live.back();
+            live.pop_back();
+        }
+        else{
+            block& resized {live[static_cast<std::size_t>(rng() % live.size())]};
+            resized.size = rng() % 2 ? std::min<std::size_t>(resized.size * 2, 1 << 20) : std::max<std::size_t>(resized.size / 2, 16);
+            trace.append(trace_op::resize, reinterpret_cast<const void*>(resized.id), resized.size, 1);
+        }
+    }
+}
+
+/**
+ * @brief with_pool_chunk Calls body with the smallest pool_target whose chunk holds size bytes, up to 1 KiB
+ */
+template<typename Body>
+static bool with_pool_chunk(std::size_t size, Body&& body){
+    if(size <= 32)
+        return body.template operator()<32>();
+    if(size <= 64)
+        return body.template operator()<64>();
+    if(size <= 128)
+        return body.template operator()<128>();
+    if(size <= 256)
+        return body.template operator()<256>();
+    if(size <= 512)
+        return body.template operator()<512>();
+    return body.template operator()<1024>();
+}
+
+int main(int argc, char* argv[]){
+
+    bool quick {false};
+    std::string path;
+    for(int i = 1; i < argc; ++i){
+        if(std::strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else
+            path = argv[i];
+    }
+
+    const bool sample {path.empty()};
+    if(sample){
+        path = "trace_replay_sample.trace";
+        record_sample(path.c_str(), quick ? std::size_t{1} << 15 : std::size_t{1} << 22);
+    }
+    const compiled_trace trace {compile(read_trace(path.c_str()))};
+    if(sample)
+        unlink(path.c_str());
+    const std::string pattern {sample ? std::string{"sample"} : path.substr(path.find_last_of('/') + 1)};
+
+    bool ok {true};
+    ok &= bench::run_isolated([&]{
+        malloc_target target;
+        return replay("malloc", pattern, trace, target);
+    });
+    ok &= with_pool_chunk(trace.common_size, [&]<std::size_t chunk>(){
+        return bench::run_isolated([&]{
+            pool_target<chunk> target(trace.peak_live_blocks);
+            const std::string name {"pool_allocator<" + std::to_string(chunk) + ">+malloc"};
+            return replay(name.c_str(), pattern, trace, target);
+        });
+    });
+    ok &= bench::run_isolated([&]{
+        arena_target<heap_arena> target(std::size_t{1} << 20);
+        return replay("heap_arena", pattern, trace, target);
+    });
+    ok &= bench::run_isolated([&]{
+        // The buffer only reserves address space, its pages are faulted in as the shard carves them
+        arena_target<concurrent_arena> target(std::max<std::size_t>(trace.peak_live_bytes * 8, std::size_t{1} << 26), 1);
+        return replay("concurrent_arena", pattern, trace, target);
+    });
+    ok &= bench::run_isolated([&]{
+        small_object_target target;
+        return replay("small_object_allocator", pattern, trace, target);
+    });
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include "background_trimmer.hpp"
+#include "benchmark_common.hpp"
+#include "heap_buffer_arena.hpp"
+#include "pool_allocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ *  Resident memory over a bursty workload. Every burst allocates and touches a large number of objects,
+ *  then frees all of them but the last 5% allocated, which survive until the end of the next burst. The
+ *  burst is followed by an idle period in which the RSS of the process is sampled. Without trimming the
+ *  idle RSS stays at the peak of the bursts, trim() returns the free pages either right after the burst,
+ *  lazily with MADV_FREE, or from a background_trimmer during the idle period. Usage:
+ *
+ *      trim_benchmark [--quick]
+ */
+
+enum class trim_mode{
+    none,
+    trim,
+    trim_lazy,
+    background
+};
+
+constexpr const char* mode_names[] {"no_trim", "trim", "trim_lazy_free", "background_trimmer"};
+
+struct workload{
+    std::size_t bursts;
+    std::size_t objects;
+    std::chrono::milliseconds idle;
+};
+
+/**
+ * @brief run_bursts Runs the workload on an allocator wrapped by the allocate, deallocate and trim callables
+ */
+template<typename Allocate, typename Deallocate, typename Trim>
+bench::result run_bursts(const char* name, trim_mode mode, const workload& work, Allocate&& allocate, Deallocate&& deallocate, Trim&& trim){
+
+    std::mutex lock;
+    std::size_t released {0};
+    std::unique_ptr<background_trimmer> trimmer;
+    if(mode == trim_mode::background){
+        trimmer = std::make_unique<background_trimmer>(work.idle / 4, [&]{
+            std::lock_guard guard {lock};
+            const std::size_t bytes {trim(decommit_advice::dont_need)};
+            released += bytes;
+            return bytes;
+        });
+    }
+
+    std::mt19937_64 rng {42};
+    std::vector<std::byte*> objects(work.objects);
+    std::vector<std::byte*> survivors;
+    long burst_rss {0};
+    long idle_rss {0};
+    double seconds {0};
+
+    for(std::size_t burst = 0; burst < work.bursts; ++burst){
+        {
+            std::lock_guard guard {lock};
+            const bench::timer time;
+            for(std::byte*& object : objects){
+                const std::size_t bytes {64 + rng() % 960};
+                object = allocate(bytes);
+                std::memset(object, static_cast<int>(burst), std::min<std::size_t>(bytes, 64));
+                bench::do_not_optimize(object);
+            }
+            burst_rss = std::max(burst_rss, bench::current_rss_kb());
+
+            for(std::byte* object : survivors)
+                deallocate(object);
+            const std::size_t kept {objects.size() / 20};
+            survivors.assign(objects.end() - static_cast<std::ptrdiff_t>(kept), objects.end());
+            for(auto object = objects.begin(); object != objects.end() - static_cast<std::ptrdiff_t>(kept); ++object)
+                deallocate(*object);
+
+            if(mode == trim_mode::trim)
+                released += trim(decommit_advice::dont_need);
+            else if(mode == trim_mode::trim_lazy)
+                released += trim(decommit_advice::lazy_free);
+            seconds += time.seconds();
+        }
+        std::this_thread::sleep_for(work.idle);
+        idle_rss += bench::current_rss_kb();
+    }
+    for(std::byte* object : survivors)
+        deallocate(object);
+
+    trimmer.reset();
+    const std::size_t ops {work.bursts * work.objects * 2};
+    return bench::result{"trim", name, mode_names[static_cast<int>(mode)], ops, seconds, 0, true,
+                         "\"burst_rss_kb\":" + std::to_string(burst_rss) +
+                         ",\"idle_rss_kb\":" + std::to_string(idle_rss / static_cast<long>(work.bursts)) +
+                         ",\"released_kb\":" + std::to_string(released / 1024)};
+}
+
+int main(int argc, char* argv[]){
+
+    const bool quick {argc > 1 && std::strcmp(argv[1], "--quick") == 0};
+    const workload work {quick ? std::size_t{4} : std::size_t{8}, quick ? std::size_t{1} << 12 : std::size_t{1} << 18,
+                         std::chrono::milliseconds(quick ? 4 : 40)};
+
+    bool ok {true};
+    for(trim_mode mode : {trim_mode::none, trim_mode::trim, trim_mode::trim_lazy, trim_mode::background}){
+        ok &= bench::run_isolated([&]{
+            // Objects rounded up to 1 KiB chunks
+            pool_allocator<1024, 8> pool(work.objects * 2 * 1024);
+            return run_bursts("pool_allocator", mode, work,
+                              [&](std::size_t){ return pool.allocate(); },
+                              [&](std::byte* ptr){ pool.deallocate(ptr); },
+                              [&](decommit_advice advice){ return pool.trim(advice); });
+        });
+        ok &= bench::run_isolated([&]{
+            heap_arena ar {work.objects * 2 * 1024};
+            return run_bursts("heap_arena", mode, work,
+                              [&](std::size_t bytes){ return ar.allocate(bytes); },
+                              [&](std::byte* ptr){ ar.deallocate(ptr); },
+                              [&](decommit_advice advice){ return ar.trim(advice); });
+        });
+    }
+    return ok ? 0 : 1;
+}
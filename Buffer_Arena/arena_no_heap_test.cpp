@@ -0,0 +1,104 @@
+#include "static_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+#include "stack_allocator.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <new>
+#include <vector>
+
+/*
+ *  Verifies that arena, linear_contiguous_allocator and stack_allocator never call the global allocator.
+ *  All the replaceable global allocation functions are interposed and count their calls while the
+ *  allocators are exercised.
+ */
+
+static bool counting {false};
+static std::size_t global_allocations {0};
+
+static void* counted_malloc(std::size_t size){
+    if(counting)
+        ++global_allocations;
+    if(void* ptr {std::malloc(size ? size : 1)}; ptr)
+        return ptr;
+    throw std::bad_alloc();
+}
+
+static void* counted_aligned_alloc(std::size_t size, std::align_val_t align){
+    if(counting)
+        ++global_allocations;
+    const std::size_t alignment {static_cast<std::size_t>(align)};
+    if(void* ptr {std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)}; ptr)
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size){ return counted_malloc(size); }
+void* operator new[](std::size_t size){ return counted_malloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { try{ return counted_malloc(size); } catch(...){ return nullptr; } }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { try{ return counted_malloc(size); } catch(...){ return nullptr; } }
+void* operator new(std::size_t size, std::align_val_t align){ return counted_aligned_alloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align){ return counted_aligned_alloc(size, align); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+
+static arena<64 * 1024> ar;
+
+int main(){
+
+    stack_allocator<int, 1024> stk_alloc;
+    linear_contiguous_allocator<64 * 1024> alloc {ar};
+
+    counting = true;
+
+    {
+        std::byte* blocks[64];
+        for(std::size_t i = 0; i < 64; ++i){
+            blocks[i] = ar.allocate(16 + i * 8, std::size_t{1} << (i % 7));
+        }
+        for(std::size_t i = 0; i < 64; i += 2){
+            ar.deallocate(blocks[i]);
+        }
+        for(std::size_t i = 0; i < 64; i += 2){
+            blocks[i] = ar.allocate(24);
+        }
+        for(std::byte* block : blocks){
+            ar.deallocate(block);
+        }
+    }
+
+    {
+        std::byte* addr1 {alloc.allocate(64)};
+        std::byte* addr2 {alloc.allocate(128, 64)};
+        alloc.deallocate(addr1);
+        std::byte* addr3 {alloc.allocate(32)};
+        alloc.deallocate(addr2);
+        alloc.deallocate(addr3);
+    }
+
+    {
+        std::vector<int, stack_allocator<int, 1024>> vec {stk_alloc};
+        for(int i=0; i<200; i++){
+            vec.push_back(i);
+        }
+
+        std::list<int, stack_allocator<int, 1024>> lst{stk_alloc};
+        for(int i=0; i<100; i++){
+            lst.push_back(i);
+        }
+        lst.resize(50);
+    }
+
+    counting = false;
+
+    std::printf("Global allocations while using the arena allocators: %zu\n", global_allocations);
+    return global_allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "heap_buffer_arena.hpp"
+#include "static_buffer_arena.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <cstring>
+
+static bool disjoint(const std::byte* a, std::size_t a_size, const std::byte* b, std::size_t b_size){
+    return a + a_size <= b || b + b_size <= a;
+}
+
+int main(){
+
+    {
+        // Blocks shrunk or deallocated after the marker leave free blocks past it, the rewind drops them
+        arena<4096> ar;
+        const arena_marker marker {ar.get_marker()};
+        std::byte* shrunk {ar.allocate(1024)};
+        [[maybe_unused]] std::byte* after {ar.allocate(64)};
+        CHECK(ar.try_shrink(shrunk, 64));
+        std::byte* freed {ar.allocate(256)};
+        [[maybe_unused]] std::byte* last {ar.allocate(64)};
+        ar.deallocate(freed);
+        ar.rewind(marker);
+        CHECK(ar.get_occupied_bytes() == 0);
+        CHECK(ar.get_available_bytes() == 4096);
+
+        std::byte* first {ar.allocate(2048)};
+        std::byte* second {ar.allocate(512)};
+        CHECK(disjoint(first, 2048, second, 512));
+        ar.deallocate(first);
+        ar.deallocate(second);
+        ar.deallocate(ar.allocate(4000));
+    }
+
+    {
+        // An alignment gap after the marker is absorbed by the block before it, the rewind gives it back
+        arena<4096> ar;
+        std::byte* first {ar.allocate(64)};
+        const arena_marker marker {ar.get_marker()};
+        [[maybe_unused]] std::byte* aligned {ar.allocate(16, 256)};
+        ar.rewind(marker);
+        ar.deallocate(first);
+        CHECK(ar.get_occupied_bytes() == 0);
+        CHECK(ar.get_available_bytes() == 4096);
+
+        std::byte* whole {ar.allocate(4000)};
+        CHECK(ar.owns(whole) && ar.owns(whole + 3999));
+        ar.deallocate(whole);
+    }
+
+    {
+        // A gap in front of the first block after a bump allocation is counted as occupied
+        arena<4096> ar;
+        std::byte* bumped {ar.bump_allocate(1, 1)};
+        std::byte* aligned {ar.allocate(16, 256)};
+        const std::size_t gap {static_cast<std::size_t>(aligned - bumped) - 1 - sizeof(block_header)};
+        CHECK(ar.get_occupied_bytes() == 1 + gap + arena_block_size(16));
+        ar.deallocate(aligned);
+        CHECK(ar.get_occupied_bytes() == 1 + gap);
+        CHECK(ar.get_occupied_bytes() + ar.get_available_bytes() == 4096);
+        ar.reset();
+        CHECK(ar.get_occupied_bytes() == 0);
+    }
+
+    {
+        // Free blocks of the regions chained after the marker are dropped with the regions
+        heap_arena ar {4096};
+        const arena_marker marker {ar.get_marker()};
+        std::byte* shrunk {ar.allocate(32 * 1024)};
+        CHECK(ar.regions() == 2);
+        [[maybe_unused]] std::byte* after {ar.allocate(64)};
+        CHECK(ar.try_shrink(shrunk, 64));
+        ar.rewind(marker);
+        CHECK(ar.regions() == 1);
+
+        std::byte* first {ar.allocate(32 * 1024)};
+        std::memset(first, 1, 32 * 1024);
+        std::byte* second {ar.allocate(1024)};
+        std::memset(second, 2, 1024);
+        CHECK(disjoint(first, 32 * 1024, second, 1024));
+        CHECK(first[32 * 1024 - 1] == std::byte{1});
+        ar.deallocate(first);
+        ar.deallocate(second);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,96 @@
+#include "background_trimmer.hpp"
+#include "concurrent_buffer_arena.hpp"
+#include "heap_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+int main(){
+
+    const std::size_t page {static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+
+    {
+        // Free blocks between blocks in use give back their interior pages, their headers stay valid
+        heap_arena ar {std::size_t{4} << 20};
+        std::vector<std::byte*> blocks;
+        for(int i = 0; i < 64; ++i){
+            blocks.push_back(ar.allocate(4 * page));
+            std::memset(blocks.back(), i, 4 * page);
+        }
+        for(std::size_t i = 0; i < blocks.size(); i += 2)
+            ar.deallocate(blocks[i]);
+
+        const std::size_t released {ar.trim()};
+        CHECK(released >= 32 * 3 * page && released <= 32 * 4 * page);
+        CHECK(test::resident_pages(blocks[0], blocks[0] + 4 * page) <= 1);
+        CHECK(blocks[1][4 * page - 1] == std::byte{1});
+
+        // The free blocks are reused and merged as before
+        std::byte* reused {ar.allocate(2 * page)};
+        CHECK(reused == blocks[62]);
+        std::memset(reused, 9, 2 * page);
+        ar.deallocate(reused);
+        for(std::size_t i = 1; i < blocks.size(); i += 2)
+            ar.deallocate(blocks[i]);
+        CHECK(ar.get_occupied_bytes() == 0);
+
+        // Everything was merged into the unused tail, which is released as a whole
+        CHECK(ar.trim() >= 32 * 3 * page);
+        CHECK(ar.trim() == 0);
+    }
+
+    {
+        // A rewound scratch frame leaves its pages in the unused tail of the arena
+        static arena<std::size_t{1} << 20> ar;
+        basic_linear_allocator<arena<std::size_t{1} << 20>, linear_mode::monotonic> alloc {ar};
+        {
+            scratch_scope frame {alloc};
+            std::byte* scratch {alloc.allocate(512 * 1024)};
+            std::memset(scratch, 3, 512 * 1024);
+        }
+        CHECK(alloc.trim(decommit_advice::lazy_free) >= 512 * 1024 - page);
+    }
+
+    {
+        // A concurrent arena is trimmed from a background thread while it is in use
+        concurrent_arena ar {std::size_t{16} << 20, 4};
+        std::atomic<std::size_t> released {0};
+        {
+            background_trimmer trimmer(std::chrono::milliseconds(1), [&]{
+                const std::size_t bytes {ar.trim()};
+                released += bytes;
+                return bytes;
+            });
+            std::vector<std::thread> threads;
+            for(int t = 0; t < 4; ++t){
+                threads.emplace_back([&ar]{
+                    for(int round = 0; round < 8; ++round){
+                        std::vector<std::byte*> blocks;
+                        for(int i = 0; i < 64; ++i){
+                            blocks.push_back(ar.allocate(8192));
+                            std::memset(blocks.back(), round, 8192);
+                        }
+                        for(std::byte* block : blocks){
+                            if(block[8191] != std::byte(round))
+                                std::abort();
+                            ar.deallocate(block);
+                        }
+                    }
+                });
+            }
+            for(auto& th : threads)
+                th.join();
+        }
+        released += ar.trim();
+        CHECK(ar.get_occupied_bytes() == 0);
+        CHECK(released >= 64 * 8192 / 2);
+    }
+
+    return test::exit_code();
+}
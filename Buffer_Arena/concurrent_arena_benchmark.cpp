@@ -0,0 +1,81 @@
+#include "concurrent_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ *  Scalability benchmark for concurrent_arena. Every thread allocates a burst of blocks of mixed sizes through
+ *  its own copy of a linear allocator and frees them again. The same workload is run against a single arena
+ *  guarded by a std::mutex, which is how linear_contiguous_allocator has to be shared between threads.
+ *  Usage:
+ *
+ *      concurrent_arena_benchmark [max_threads] [ops_per_thread]
+ */
+
+constexpr std::size_t burst {32};
+constexpr std::size_t arena_bytes {64 * 1024 * 1024};
+
+struct mutex_arena{
+    arena<arena_bytes> ar;
+    std::mutex mtx;
+
+    std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        std::lock_guard<std::mutex> lock{mtx};
+        return ar.allocate(count, align);
+    }
+
+    void deallocate(std::byte* ptr){
+        std::lock_guard<std::mutex> lock{mtx};
+        ar.deallocate(ptr);
+    }
+};
+
+template<typename Arena>
+double run(Arena& ar, std::size_t threads, std::size_t ops_per_thread){
+
+    std::vector<std::thread> workers;
+    const auto start {std::chrono::steady_clock::now()};
+    for(std::size_t t = 0; t < threads; ++t){
+        workers.emplace_back([alloc = basic_linear_allocator<Arena>{ar}, ops_per_thread]() mutable {
+            std::byte* blocks[burst];
+            for(std::size_t op = 0; op < ops_per_thread; op += burst){
+                for(std::size_t i = 0; i < burst; ++i)
+                    blocks[i] = alloc.allocate(16 + (op + i * 37) % 240);
+                for(auto block : blocks)
+                    alloc.deallocate(block);
+            }
+        });
+    }
+    std::for_each(workers.begin(), workers.end(), [](std::thread& th){ th.join(); });
+    const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start};
+
+    // One operation is an allocate / deallocate pair
+    return static_cast<double>(threads * ops_per_thread) / elapsed.count();
+}
+
+int main(int argc, char* argv[]){
+
+    const std::size_t max_threads {argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency())};
+    const std::size_t ops_per_thread {argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2'000'000};
+
+    std::printf("%-8s %-18s %-18s %-8s\n", "threads", "mutex_arena ops/s", "sharded ops/s", "speedup");
+    for(std::size_t threads = 1; threads <= max_threads; threads *= 2){
+
+        auto locked {std::make_unique<mutex_arena>()};
+        concurrent_arena sharded {arena_bytes, max_threads};
+
+        const double locked_ops {run(*locked, threads, ops_per_thread)};
+        const double sharded_ops {run(sharded, threads, ops_per_thread)};
+        std::printf("%-8zu %-18.0f %-18.0f %-8.2f\n", threads, locked_ops, sharded_ops, sharded_ops / locked_ops);
+
+        if(threads < max_threads && threads * 2 > max_threads)
+            threads = max_threads / 2;
+    }
+    return 0;
+}
@@ -0,0 +1,444 @@
+#ifndef CONCURRENT_BUFFER_ARENA_HPP
+#define CONCURRENT_BUFFER_ARENA_HPP
+
+
+/**
+ * Concurrent Arena is the thread-safe counterpart of arena. Copies of a basic_linear_allocator over a
+ * concurrent_arena can be used by any number of threads without external locking. The arena is split into
+ * shards, each one a TLSF arena of its own, and every thread sticks to one shard so that threads do not
+ * contend with each other. Shards take their memory on demand from a shared buffer, whose bump pointer
+ * advances with an atomic compare-and-swap.
+ */
+
+
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <sys/mman.h>
+#include "mmap_backing.hpp"
+#include "static_buffer_arena.hpp"
+
+// Largest block of a concurrent_arena, decides the number of free lists of every shard
+constexpr std::size_t concurrent_arena_max_region {std::size_t{1} << 46};
+
+// Granularity at which shards take memory from the shared buffer
+constexpr std::size_t concurrent_arena_region {64 * 1024};
+
+
+/**
+ * @brief The concurrent_arena class
+ * A thread allocates from its preferred shard, which it locks with a single uncontended atomic exchange.
+ * If the shard is held by another thread, e.g. because there are more threads than shards, the thread moves
+ * on to the next free shard and prefers that one from then on.
+ *
+ * Every region a shard takes from the buffer is recorded in an owner table, so a block can be returned
+ * to its shard by any thread. If the owning shard is busy the block is pushed onto its lock-free list of
+ * remote frees instead, and the owner releases it the next time it locks the shard.
+ *
+ * Markers are not supported, bump-allocated blocks are released with reset(), which like the destructor
+ * must not run concurrently with any other member.
+ */
+
+class concurrent_arena{
+
+    using core = basic_arena<concurrent_arena_max_region>;
+
+    class alignas(64) shard : public core{
+
+        std::atomic<bool> busy {false};
+        std::atomic<std::byte*> remote_frees {nullptr}; // Blocks deallocated by other threads while the shard was busy
+
+    public:
+
+        using core::try_allocate;
+        using core::try_bump_allocate;
+        using core::release;
+        using core::try_expand_block;
+        using core::shrink_block;
+        using core::start_region;
+        using core::clear;
+        using core::available_bytes;
+        using core::occupied_bytes;
+        using core::stats;
+
+        shard() noexcept : core(nullptr, 0) {}
+
+        /**
+         * @brief try_lock Takes the shard and releases the blocks freed remotely in the meantime
+         * @return false if the shard is held by another thread
+         */
+        bool try_lock() noexcept {
+            if(busy.load(std::memory_order_relaxed) || busy.exchange(true, std::memory_order_acquire))
+                return false;
+            if(std::byte* ptr {remote_frees.load(std::memory_order_relaxed)}; ptr){
+                ptr = remote_frees.exchange(nullptr, std::memory_order_acquire);
+                while(ptr){
+                    std::byte* next {*reinterpret_cast<std::byte**>(ptr)};
+                    release(ptr);
+                    ptr = next;
+                }
+            }
+            return true;
+        }
+
+        void lock() noexcept {
+            while(!try_lock())
+                std::this_thread::yield();
+        }
+
+        void unlock() noexcept {
+            busy.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @brief push_remote Defers the release of a block to the thread holding the shard
+         * The link is stored in the user data of the block, which is at least sizeof(free_block_links).
+         */
+        void push_remote(std::byte* ptr) noexcept {
+            std::byte* head {remote_frees.load(std::memory_order_relaxed)};
+            do{
+                *reinterpret_cast<std::byte**>(ptr) = head;
+            }
+            while(!remote_frees.compare_exchange_weak(head, ptr, std::memory_order_release, std::memory_order_relaxed));
+        }
+    };
+
+    std::unique_ptr<shard[]> shard_list;
+    std::unique_ptr<std::uint32_t[]> region_owner; // Index of the shard owning each region of the buffer
+    std::byte* buffer;
+    std::size_t capacity;
+    std::size_t mapped_bytes; // Length of the mapping, 0 for user-provided memory
+    std::size_t shard_count;
+
+    alignas(64) std::atomic<std::size_t> carved_bytes {0}; // Bump pointer of the buffer, advanced by the shards
+
+private:
+
+    /**
+     * @brief preferred_shard Shard the calling thread tried first last time
+     * Threads are numbered in the order they first use any concurrent_arena, the first shard_count threads
+     * start on distinct shards.
+     */
+    static std::size_t& preferred_shard() noexcept {
+        static std::atomic<std::size_t> thread_count {0};
+        thread_local std::size_t preferred {thread_count.fetch_add(1, std::memory_order_relaxed)};
+        return preferred;
+    }
+
+    /**
+     * @brief lock_shard Locks the preferred shard of the calling thread or the next free one
+     */
+    shard& lock_shard() noexcept {
+        std::size_t& preferred {preferred_shard()};
+        for(;;){
+            for(std::size_t i = 0; i < shard_count; ++i){
+                const std::size_t index {(preferred + i) % shard_count};
+                if(shard_list[index].try_lock()){
+                    preferred = index;
+                    return shard_list[index];
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief grow Moves the bump pointer of the buffer to give the locked shard a new region large enough
+     * for count bytes aligned to align
+     * @return false if the buffer is exhausted
+     */
+    bool grow(shard& sh, std::size_t count, std::size_t align) noexcept {
+
+        // Room for the block, its worst case alignment gap and the header terminating the region
+        const std::size_t needed {arena_block_size(count) + std::max(align, arena_granularity) + arena_granularity + sizeof(block_header)};
+        const std::size_t bytes {(std::max(needed, concurrent_arena_region) + concurrent_arena_region - 1) / concurrent_arena_region * concurrent_arena_region};
+
+        std::size_t begin {carved_bytes.load(std::memory_order_relaxed)};
+        do{
+            if(begin >= capacity || capacity - begin < std::min(bytes, needed))
+                return false;
+        }
+        while(!carved_bytes.compare_exchange_weak(begin, std::min(begin + bytes, capacity), std::memory_order_relaxed));
+
+        // The last region may be cut short by the end of the buffer
+        const std::size_t end {std::min(begin + bytes, capacity)};
+        const std::uint32_t owner {static_cast<std::uint32_t>(&sh - shard_list.get())};
+        for(std::size_t region = begin / concurrent_arena_region; region * concurrent_arena_region < end; ++region)
+            region_owner[region] = owner;
+
+        sh.start_region(buffer + begin, end - begin - sizeof(block_header));
+        return true;
+    }
+
+    /**
+     * @brief allocate_elsewhere Serves a request which the locked shard and the buffer cannot serve from
+     * the free lists of the other shards
+     */
+    std::byte* allocate_elsewhere(const shard& own, std::size_t count, std::size_t align) noexcept {
+        for(std::size_t i = 0; i < shard_count; ++i){
+            shard& sh {shard_list[i]};
+            if(&sh == &own || !sh.try_lock())
+                continue;
+            std::byte* ptr {sh.try_allocate(count, align)};
+            sh.unlock();
+            if(ptr)
+                return ptr;
+        }
+        return nullptr;
+    }
+
+    concurrent_arena(const backing_region& mapping, void* user_buffer, std::size_t size, std::size_t _shard_count) :
+        shard_list{std::make_unique<shard[]>(std::max<std::size_t>(_shard_count, 1))},
+        region_owner{std::make_unique<std::uint32_t[]>(size / concurrent_arena_region + 1)},
+        buffer{static_cast<std::byte*>(user_buffer ? user_buffer : mapping.address)},
+        capacity{size},
+        mapped_bytes{user_buffer ? 0 : mapping.bytes},
+        shard_count{std::max<std::size_t>(_shard_count, 1)}
+    {
+        if(!user_buffer && mapping.address == MAP_FAILED)
+            throw std::bad_alloc();
+        if(reinterpret_cast<std::uintptr_t>(buffer) % arena_granularity)
+            throw std::logic_error("Buffer is not aligned for an arena");
+    }
+
+public:
+
+    /**
+     * @brief concurrent_arena Converting constructor
+     * Maps an anonymous buffer of the required size, which is unmapped when the arena is destroyed.
+     * @param bytes Size of the buffer shared by all shards
+     * @param shard_count Number of shards, threads beyond that number share shards
+     * @param backing Backing options of the buffer
+     */
+    explicit concurrent_arena(std::size_t bytes, std::size_t shard_count = std::max(1u, std::thread::hardware_concurrency()), const mmap_backing& backing = {}) :
+        concurrent_arena(map_backing(bytes, backing), nullptr, bytes, shard_count) {}
+
+    /**
+     * @brief concurrent_arena Converting constructor
+     * Shares the user-provided memory buffer between the shards.
+     * @param buffer Starting address of memory buffer, aligned to alignof(std::max_align_t)
+     * @param buffer_size Size of memory buffer in bytes
+     * @param shard_count Number of shards, threads beyond that number share shards
+     */
+    concurrent_arena(void* buffer, std::size_t buffer_size, std::size_t shard_count) :
+        concurrent_arena(backing_region{}, buffer, buffer_size, shard_count) {}
+
+    // Arena cannot be copied or moved, blocks point into it
+    concurrent_arena(const concurrent_arena&) = delete;
+    concurrent_arena& operator= (const concurrent_arena&) = delete;
+
+    ~concurrent_arena(){
+        if(mapped_bytes)
+            munmap(buffer, mapped_bytes);
+    }
+
+    /**
+     * @brief allocate Allocates the storage from the shard of the calling thread
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     *
+     * Once the buffer is exhausted, blocks freed to the other shards are used as well.
+     */
+    [[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        shard& sh {lock_shard()};
+        std::byte* ptr {sh.try_allocate(count, align)};
+        if(!ptr && grow(sh, count, align))
+            ptr = sh.try_allocate(count, align);
+        if(!ptr)
+            ptr = allocate_elsewhere(sh, count, align);
+        if(!ptr)
+            sh.stats.record_failure();
+        sh.unlock();
+        if(!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    /**
+     * @brief deallocate Deallocates the storage, from any thread
+     * @param ptr Address of the block to deallocate
+     *
+     * The block is released at once if its shard is free, otherwise the owner of the shard releases it.
+     * Addresses which do not belong to the arena are ignored.
+     */
+    [[gnu::nonnull]]
+    void deallocate(std::byte* ptr){
+        if(!owns(ptr))
+            return;
+        shard& sh {shard_list[region_owner[static_cast<std::size_t>(ptr - buffer) / concurrent_arena_region]]};
+        if(sh.try_lock()){
+            sh.release(ptr);
+            sh.unlock();
+        }
+        else{
+            sh.push_remote(ptr);
+        }
+    }
+
+    /**
+     * @brief try_expand Grows the block in place, from any thread
+     * @param ptr Address of a block allocated with allocate()
+     * @param count New size of the block in bytes
+     * @return true if the block now holds count bytes, false if it is unchanged and would have to be moved
+     */
+    bool try_expand(std::byte* ptr, std::size_t count) noexcept {
+        if(!owns(ptr))
+            return false;
+        shard& sh {shard_list[region_owner[static_cast<std::size_t>(ptr - buffer) / concurrent_arena_region]]};
+        sh.lock();
+        const bool expanded {sh.try_expand_block(ptr, count)};
+        sh.unlock();
+        return expanded;
+    }
+
+    /**
+     * @brief try_shrink Shrinks the block in place and returns its tail to its shard, from any thread
+     * @param ptr Address of a block allocated with allocate()
+     * @param count New size of the block in bytes
+     * @return true if memory was released, false if the block is unchanged
+     */
+    bool try_shrink(std::byte* ptr, std::size_t count) noexcept {
+        if(!owns(ptr))
+            return false;
+        shard& sh {shard_list[region_owner[static_cast<std::size_t>(ptr - buffer) / concurrent_arena_region]]};
+        sh.lock();
+        const bool shrunk {sh.shrink_block(ptr, count)};
+        sh.unlock();
+        return shrunk;
+    }
+
+    /**
+     * @brief bump_allocate Allocates the storage from the shard of the calling thread without a block header
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     *
+     * Blocks allocated this way cannot be passed to deallocate(), they are only released by reset().
+     */
+    [[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* bump_allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        shard& sh {lock_shard()};
+        std::byte* ptr {sh.try_bump_allocate(count, align)};
+        if(!ptr && grow(sh, count, align))
+            ptr = sh.try_bump_allocate(count, align);
+        if(!ptr)
+            sh.stats.record_failure();
+        sh.unlock();
+        if(!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    /**
+     * @brief reset Releases all the blocks of all the shards and returns the buffer to its initial state
+     * Must not run concurrently with any other member.
+     */
+    void reset() noexcept {
+        trace_release(buffer, buffer + capacity);
+        for(std::size_t i = 0; i < shard_count; ++i){
+            shard_list[i].lock();
+            shard_list[i].clear(nullptr, 0);
+            shard_list[i].unlock();
+        }
+        carved_bytes.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief trim Returns the free pages of every shard and the part of the buffer no shard has taken to the
+     * operating system, from any thread
+     * All the shards are held while trimming, so that none of them takes a new region from the buffer.
+     * @param advice How the pages are returned
+     * @return Number of resident bytes released
+     */
+    std::size_t trim(decommit_advice advice = decommit_advice::dont_need) noexcept {
+        for(std::size_t i = 0; i < shard_count; ++i)
+            shard_list[i].lock();
+        std::size_t released {decommit(buffer + carved_bytes.load(std::memory_order_relaxed), buffer + capacity, advice)};
+        for(std::size_t i = 0; i < shard_count; ++i){
+            released += shard_list[i].trim(advice);
+            shard_list[i].unlock();
+        }
+        return released;
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to the buffer of the arena
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        const std::byte* addr {static_cast<const std::byte*>(ptr)};
+        return addr >= buffer && addr < buffer + carved_bytes.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief shards
+     * @return Number of shards the threads are spread over
+     */
+    std::size_t shards() const noexcept {
+        return shard_count;
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Statistics of all the shards combined
+     * The peak is the sum of the shard peaks, an upper bound of the peak of the whole arena.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        allocator_stats_snapshot total;
+        std::size_t free_bytes {capacity - carved_bytes.load(std::memory_order_relaxed)};
+        double largest_free {static_cast<double>(free_bytes)};
+        for(std::size_t i = 0; i < shard_count; ++i){
+            shard_list[i].lock();
+            const allocator_stats_snapshot snap {shard_list[i].get_stats()};
+            const std::size_t available {shard_list[i].available_bytes};
+            shard_list[i].unlock();
+
+            total.allocations += snap.allocations;
+            total.deallocations += snap.deallocations;
+            total.failed_allocations += snap.failed_allocations;
+            total.live_bytes += snap.live_bytes;
+            total.peak_live_bytes += snap.peak_live_bytes;
+            total.padding_bytes += snap.padding_bytes;
+            for(std::size_t b = 0; b < total.size_histogram.size(); ++b)
+                total.size_histogram[b] += snap.size_histogram[b];
+            free_bytes += available;
+            largest_free = std::max(largest_free, (1.0 - snap.fragmentation) * static_cast<double>(available));
+        }
+        total.fragmentation = fragmentation_ratio(static_cast<std::size_t>(largest_free), free_bytes);
+        return total;
+    }
+#endif
+
+#ifdef ARENA_BYTE_INFO
+    std::size_t get_available_bytes() const {
+        std::size_t bytes {capacity - carved_bytes.load(std::memory_order_relaxed)};
+        for(std::size_t i = 0; i < shard_count; ++i){
+            shard_list[i].lock();
+            bytes += shard_list[i].available_bytes;
+            shard_list[i].unlock();
+        }
+        return bytes;
+    }
+
+    std::size_t get_occupied_bytes() const {
+        std::size_t bytes {0};
+        for(std::size_t i = 0; i < shard_count; ++i){
+            shard_list[i].lock();
+            bytes += shard_list[i].occupied_bytes;
+            shard_list[i].unlock();
+        }
+        return bytes;
+    }
+#endif
+};
+
+
+#endif // CONCURRENT_BUFFER_ARENA_HPP
@@ -0,0 +1,160 @@
+#include "concurrent_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+#include "test_common.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct block{
+    std::byte* ptr;
+    std::size_t size;
+    unsigned char tag;
+};
+
+int main(){
+
+    constexpr std::size_t threads {4};
+
+    {
+        // Every thread allocates through its own copy of the allocator and hands half of its blocks
+        // to the next thread, which frees them
+        concurrent_arena ar {32 * 1024 * 1024, threads};
+        basic_linear_allocator<concurrent_arena> shared {ar};
+
+        std::vector<std::vector<block>> handoff(threads);
+        std::vector<std::mutex> handoff_mtx(threads);
+        std::atomic<int> corrupted {0};
+        std::vector<std::thread> workers;
+        for(std::size_t t = 0; t < threads; ++t){
+            workers.emplace_back([&, t, alloc = shared]() mutable {
+                std::mt19937 rng {static_cast<unsigned>(t)};
+                std::vector<block> live;
+                auto check_and_free = [&](const block& blk){
+                    for(std::size_t i = 0; i < blk.size; ++i){
+                        if(std::to_integer<unsigned char>(blk.ptr[i]) != blk.tag){
+                            ++corrupted;
+                            break;
+                        }
+                    }
+                    alloc.deallocate(blk.ptr);
+                };
+
+                for(int i = 0; i < 50000; ++i){
+                    if(live.size() < 64 || rng() % 2){
+                        const std::size_t size {rng() % 2 ? rng() % 64 + 1 : rng() % 2000 + 1};
+                        const std::size_t align {std::size_t{1} << (rng() % 7)};
+                        block blk {alloc.allocate(size, align), size, static_cast<unsigned char>(rng())};
+                        if(reinterpret_cast<std::uintptr_t>(blk.ptr) % align)
+                            ++corrupted;
+                        std::memset(blk.ptr, blk.tag, size);
+                        live.push_back(blk);
+                    }
+                    else{
+                        const std::size_t victim {rng() % live.size()};
+                        const block blk {live[victim]};
+                        live[victim] = live.back();
+                        live.pop_back();
+                        if(rng() % 2){
+                            std::lock_guard<std::mutex> lock{handoff_mtx[(t + 1) % threads]};
+                            handoff[(t + 1) % threads].push_back(blk);
+                        }
+                        else{
+                            check_and_free(blk);
+                        }
+                    }
+
+                    if(i % 64 == 0){
+                        std::vector<block> foreign;
+                        {
+                            std::lock_guard<std::mutex> lock{handoff_mtx[t]};
+                            foreign.swap(handoff[t]);
+                        }
+                        for(const block& blk : foreign)
+                            check_and_free(blk);
+                    }
+                }
+                for(const block& blk : live)
+                    check_and_free(blk);
+            });
+        }
+        for(auto& worker : workers)
+            worker.join();
+        for(const auto& blocks : handoff){
+            for(const block& blk : blocks)
+                shared.deallocate(blk.ptr);
+        }
+
+        CHECK(corrupted == 0);
+        // Only the headers terminating the abandoned regions are still in use
+        CHECK(ar.get_occupied_bytes() <= 32 * 1024 * 1024 / concurrent_arena_region * sizeof(block_header));
+        std::printf("Concurrent arena with %zu shards, %zu bytes occupied after all frees\n", ar.shards(), ar.get_occupied_bytes());
+    }
+
+    {
+        // Blocks freed to another shard are reused once the buffer is exhausted
+        concurrent_arena ar {4 * concurrent_arena_region, threads};
+        std::vector<std::byte*> blocks;
+        std::thread filler([&]{
+            try{
+                for(;;)
+                    blocks.push_back(ar.allocate(1000));
+            }
+            catch(const std::bad_alloc&){}
+        });
+        filler.join();
+        CHECK(blocks.size() > 200);
+
+        for(std::byte* ptr : blocks)
+            ar.deallocate(ptr);
+        std::size_t reused {0};
+        std::thread reuser([&]{
+            for(std::size_t i = 0; i < blocks.size(); ++i)
+                reused += ar.owns(ar.allocate(1000));
+        });
+        reuser.join();
+        CHECK(reused == blocks.size());
+
+        ar.reset();
+        CHECK(ar.get_occupied_bytes() == 0);
+        CHECK(ar.get_available_bytes() == 4 * concurrent_arena_region);
+    }
+
+    {
+        // Monotonic scratch allocations from many threads never overlap
+        alignas(64) static std::byte buffer[1024 * 1024];
+        concurrent_arena ar {buffer, sizeof(buffer), 2};
+        basic_linear_allocator<concurrent_arena, linear_mode::monotonic> scratch {ar};
+        std::vector<std::vector<std::pair<std::byte*, std::size_t>>> spans(threads);
+        std::vector<std::thread> workers;
+        for(std::size_t t = 0; t < threads; ++t){
+            workers.emplace_back([&, t, alloc = scratch]() mutable {
+                for(std::size_t i = 0; i < 1000; ++i){
+                    const std::size_t size {i % 100 + 1};
+                    spans[t].emplace_back(alloc.allocate(size, 8), size);
+                }
+            });
+        }
+        for(auto& worker : workers)
+            worker.join();
+
+        std::map<std::byte*, std::size_t> all;
+        for(const auto& list : spans)
+            all.insert(list.begin(), list.end());
+        CHECK(all.size() == threads * 1000);
+        std::byte* prev_end {nullptr};
+        for(auto [ptr, size] : all){
+            CHECK(ptr >= prev_end && ar.owns(ptr));
+            prev_end = ptr + size;
+        }
+        scratch.reset();
+    }
+
+    return test::exit_code();
+}
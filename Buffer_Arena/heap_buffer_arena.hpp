@@ -0,0 +1,321 @@
+#ifndef HEAP_BUFFER_ARENA_HPP
+#define HEAP_BUFFER_ARENA_HPP
+
+
+/**
+ * Heap Arena is the runtime-sized counterpart of arena. The capacity is given to the constructor and the
+ * memory is either mapped from the operating system or provided by the user, so arenas of any size can be
+ * created from configuration and never live on the stack. When the arena runs out of memory it can chain
+ * additional regions, each one twice as large as the previous one. Blocks of all regions share one set of
+ * TLSF free lists, so allocation and deallocation stay O(1) however many regions are chained.
+ */
+
+
+
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "mmap_backing.hpp"
+#include "static_buffer_arena.hpp"
+
+/**
+ * @brief The arena_growth enum
+ * fixed     - The arena fails allocations once its initial region is exhausted.
+ * geometric - A new region, twice as large as the previous one or large enough for the request, is
+ *             mapped when the arena is exhausted.
+ */
+enum class arena_growth{
+    fixed,
+    geometric
+};
+
+// Largest region of a heap_arena, decides the number of free lists
+constexpr std::size_t heap_arena_max_region {std::size_t{1} << 46};
+
+
+/**
+ * @brief The heap_arena class
+ * Every region starts with a small header which links it to the previous region. The last
+ * sizeof(block_header) bytes of a region are reserved to terminate its blocks when the next region is
+ * started, so that coalescing never crosses the end of a region.
+ */
+
+class heap_arena : public basic_arena<heap_arena_max_region>{
+
+    using core = basic_arena<heap_arena_max_region>;
+
+    struct region{
+        region* prev;
+        std::byte* begin;
+        std::byte* end;             // End of the usable bytes
+        std::size_t mapped_bytes;   // Length of the mapping, 0 for user-provided memory
+    };
+
+    constexpr static std::size_t region_header {(sizeof(region) + arena_granularity - 1) / arena_granularity * arena_granularity};
+    constexpr static std::size_t region_overhead {region_header + sizeof(block_header)};
+
+    region* current;
+    arena_growth growth;
+    mmap_backing backing;
+    std::size_t next_region_bytes;
+    std::size_t region_count {1};
+
+private:
+
+    /**
+     * @brief make_region Places the region header at the start of the memory
+     */
+    static region* make_region(void* memory, std::size_t bytes, std::size_t mapped_bytes){
+        if(memory == MAP_FAILED || memory == nullptr)
+            throw std::bad_alloc();
+
+        void* start {memory};
+        std::size_t space {bytes};
+        if(!std::align(arena_granularity, region_overhead + arena_min_block_size, start, space))
+            throw std::logic_error("Buffer is too small to hold an arena region");
+
+        std::byte* base {static_cast<std::byte*>(start)};
+        return ::new(start) region{nullptr, base + region_header, base + space - sizeof(block_header), mapped_bytes};
+    }
+
+    static region* make_region(const backing_region& mapping){
+        return make_region(mapping.address, mapping.bytes, mapping.bytes);
+    }
+
+    static std::size_t region_size(const region* reg) noexcept {
+        return static_cast<std::size_t>(reg->end - reg->begin);
+    }
+
+    heap_arena(region* first, arena_growth _growth, const mmap_backing& _backing) noexcept :
+        core(first->begin, region_size(first)),
+        current{first},
+        growth{_growth},
+        backing{_backing},
+        next_region_bytes{std::min(std::max(first->mapped_bytes, region_size(first)) * 2, heap_arena_max_region)} {}
+
+    /**
+     * @brief grow Maps a new region large enough for count bytes aligned to align and makes it current
+     * @return false if the arena does not grow or the region could not be mapped
+     */
+    bool grow(std::size_t count, std::size_t align) noexcept {
+        if(growth == arena_growth::fixed)
+            return false;
+
+        const std::size_t needed {region_overhead + arena_block_size(count) + std::max(align, arena_granularity) + arena_granularity};
+        const std::size_t bytes {std::max(next_region_bytes, needed)};
+        if(bytes > heap_arena_max_region)
+            return false;
+
+        const backing_region mapping {map_backing(bytes, backing)};
+        if(mapping.address == MAP_FAILED)
+            return false;
+
+        region* reg {make_region(mapping)};
+        reg->prev = current;
+        current = reg;
+        ++region_count;
+        next_region_bytes = std::min(bytes * 2, heap_arena_max_region);
+        core::start_region(reg->begin, region_size(reg));
+        return true;
+    }
+
+    /**
+     * @brief region_of Finds the region holding the address
+     * @return The region or nullptr. Regions grow geometrically, the walk is logarithmic in the capacity.
+     */
+    region* region_of(const void* ptr) const noexcept {
+        const std::byte* addr {static_cast<const std::byte*>(ptr)};
+        for(region* reg {current}; reg; reg = reg->prev){
+            if(addr >= reg->begin && addr < reg->end)
+                return reg;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief trace_dropped_regions Records the release of every block in the regions chained after the region
+     */
+    void trace_dropped_regions(region* last) const noexcept {
+        for(region* reg {current}; reg != last; reg = reg->prev)
+            trace_release(reg->begin, reg->end);
+    }
+
+    /**
+     * @brief drop_regions Unmaps the regions chained after the region
+     */
+    void drop_regions(region* last) noexcept {
+        while(current != last){
+            region* prev {current->prev};
+            if(current->mapped_bytes)
+                munmap(current, current->mapped_bytes);
+            current = prev;
+            --region_count;
+        }
+    }
+
+    region* first_region() const noexcept {
+        region* reg {current};
+        while(reg->prev)
+            reg = reg->prev;
+        return reg;
+    }
+
+public:
+
+    /**
+     * @brief heap_arena Converting constructor
+     * Maps an anonymous region of the required size. All regions are unmapped when the arena is destroyed.
+     * @param initial_bytes Size of the first region in bytes
+     * @param growth Whether the arena chains new regions once the first one is exhausted
+     * @param backing Backing options of every mapped region
+     */
+    explicit heap_arena(std::size_t initial_bytes, arena_growth growth = arena_growth::geometric, const mmap_backing& backing = {}) :
+        heap_arena(make_region(map_backing(initial_bytes, backing)), growth, backing) {}
+
+    /**
+     * @brief heap_arena Converting constructor
+     * Manages the user-provided memory buffer, the region header is placed at its start. Regions chained
+     * with arena_growth::geometric are mapped from the operating system.
+     * @param buffer Starting address of memory buffer
+     * @param buffer_size Size of memory buffer in bytes
+     * @param growth Whether the arena chains new regions once the buffer is exhausted
+     */
+    heap_arena(void* buffer, std::size_t buffer_size, arena_growth growth = arena_growth::fixed) :
+        heap_arena(make_region(buffer, buffer_size, 0), growth, mmap_backing{}) {}
+
+    // Arena cannot be copied or moved, blocks point into it
+    heap_arena(const heap_arena&) = delete;
+    heap_arena& operator= (const heap_arena&) = delete;
+
+    ~heap_arena(){
+        drop_regions(nullptr);
+    }
+
+    /**
+     * @brief allocate Allocates the storage from arena, chaining a new region if needed
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     */
+    [[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        std::byte* ptr {core::try_allocate(count, align)};
+        if(!ptr && grow(count, align))
+            ptr = core::try_allocate(count, align);
+        if(!ptr){
+            stats.record_failure();
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    /**
+     * @brief deallocate Deallocates the storage, addresses which do not belong to the arena are ignored
+     * @param ptr Address of the block to deallocate
+     */
+    [[gnu::nonnull]]
+    void deallocate(std::byte* ptr){
+        const region* reg {region_of(ptr)};
+        if(reg == nullptr || ptr == reg->begin || (reg == current && ptr >= curr_byte))
+            return;
+        core::release(ptr);
+    }
+
+    /**
+     * @brief try_expand Grows the block in place within its region, like realloc() without the fallback to a copy
+     * @param ptr Address of a block allocated with allocate()
+     * @param count New size of the block in bytes
+     * @return true if the block now holds count bytes, false if it is unchanged and would have to be moved
+     */
+    bool try_expand(std::byte* ptr, std::size_t count) noexcept {
+        const region* reg {region_of(ptr)};
+        if(reg == nullptr || ptr == reg->begin || (reg == current && ptr >= curr_byte))
+            return false;
+        return core::try_expand_block(ptr, count);
+    }
+
+    /**
+     * @brief try_shrink Shrinks the block in place and returns its tail to the arena
+     * @param ptr Address of a block allocated with allocate()
+     * @param count New size of the block in bytes
+     * @return true if memory was released, false if the block is unchanged
+     */
+    bool try_shrink(std::byte* ptr, std::size_t count) noexcept {
+        const region* reg {region_of(ptr)};
+        if(reg == nullptr || ptr == reg->begin || (reg == current && ptr >= curr_byte))
+            return false;
+        return core::shrink_block(ptr, count);
+    }
+
+    /**
+     * @brief bump_allocate Allocates the storage without a block header, chaining a new region if needed
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     *
+     * Blocks allocated this way cannot be passed to deallocate(), they are only released by rewind()
+     * or reset().
+     */
+    [[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* bump_allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        std::byte* ptr {core::try_bump_allocate(count, align)};
+        if(!ptr && grow(count, align))
+            ptr = core::try_bump_allocate(count, align);
+        if(!ptr){
+            stats.record_failure();
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    /**
+     * @brief rewind Releases everything allocated after the marker was taken
+     * @param marker Marker returned by get_marker()
+     *
+     * Regions chained after the marker was taken are unmapped and their free blocks leave the free lists.
+     * The same rules as for arena::rewind() apply to blocks allocated or deallocated in the meantime.
+     */
+    void rewind(const arena_marker& marker) noexcept {
+        region* reg {current};
+        while(reg->prev && reg->end != marker.end_byte)
+            reg = reg->prev;
+        trace_dropped_regions(reg);
+        // Free blocks of the dropped regions would outlive their mapping
+        for(region* dropped {current}; dropped != reg; dropped = dropped->prev)
+            core::drop_free_blocks(dropped->begin, dropped->end);
+        drop_regions(reg);
+        core::restore(marker);
+    }
+
+    /**
+     * @brief reset Releases all the blocks and unmaps every region but the first one
+     */
+    void reset() noexcept {
+        trace_dropped_regions(first_region());
+        drop_regions(first_region());
+        next_region_bytes = std::min(std::max(current->mapped_bytes, region_size(current)) * 2, heap_arena_max_region);
+        core::clear(current->begin, region_size(current));
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to one of the regions of the arena
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        return region_of(ptr) != nullptr;
+    }
+
+    /**
+     * @brief regions
+     * @return Number of regions currently chained
+     */
+    std::size_t regions() const noexcept {
+        return region_count;
+    }
+};
+
+
+#endif // HEAP_BUFFER_ARENA_HPP
@@ -0,0 +1,101 @@
+#include "heap_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+#include <random>
+
+int main(int argc, char* argv[]){
+
+    // The capacity is a runtime value, e.g. read from configuration
+    const std::size_t initial_bytes {argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16 * 1024};
+
+    {
+        // Random allocations far beyond the initial capacity chain new regions
+        heap_arena ar {initial_bytes};
+        std::mt19937 rng {42};
+        std::map<std::byte*, std::size_t> live;
+        for(int i = 0; i < 20000; ++i){
+            if(live.empty() || rng() % 100 < 60){
+                const std::size_t size {rng() % 2 ? rng() % 64 + 1 : rng() % 4000 + 1};
+                const std::size_t align {std::size_t{1} << (rng() % 8)};
+                std::byte* ptr {ar.allocate(size, align)};
+                CHECK(reinterpret_cast<std::uintptr_t>(ptr) % align == 0);
+                CHECK(ar.owns(ptr));
+                auto next {live.lower_bound(ptr)};
+                CHECK(next == live.end() || ptr + size <= next->first);
+                CHECK(next == live.begin() || std::prev(next)->first + std::prev(next)->second <= ptr);
+                std::memset(ptr, 0x5A, size);
+                live[ptr] = size;
+            }
+            else{
+                auto victim {live.begin()};
+                std::advance(victim, rng() % live.size());
+                ar.deallocate(victim->first);
+                live.erase(victim);
+            }
+        }
+        std::printf("Heap arena chained %zu regions for %zu live blocks\n", ar.regions(), live.size());
+        CHECK(ar.regions() > 1);
+        for(auto [ptr, size] : live)
+            ar.deallocate(ptr);
+        CHECK(ar.get_occupied_bytes() < ar.regions() * sizeof(block_header));
+
+        ar.reset();
+        CHECK(ar.regions() == 1);
+        CHECK(ar.get_occupied_bytes() == 0);
+    }
+
+    {
+        // A runtime-sized linear allocator, scratch frames unmap the regions chained inside them
+        heap_arena ar {initial_bytes};
+        basic_linear_allocator<heap_arena, linear_mode::monotonic> scratch {ar};
+        std::byte* persistent {scratch.allocate(100)};
+        std::memset(persistent, 1, 100);
+        const std::size_t occupied {scratch.get_occupied_bytes()};
+        const std::size_t regions {ar.regions()};
+        {
+            scratch_scope frame {scratch};
+            for(int i = 0; i < 64; ++i)
+                std::memset(scratch.allocate(initial_bytes / 4, 64), 2, initial_bytes / 4);
+            CHECK(ar.regions() > regions);
+        }
+        CHECK(ar.regions() == regions);
+        CHECK(scratch.get_occupied_bytes() == occupied);
+        CHECK(persistent[99] == std::byte{1});
+
+        basic_linear_allocator<heap_arena> general {ar};
+        std::byte* block {general.allocate(initial_bytes * 8)};
+        CHECK(ar.owns(block));
+        general.deallocate(block);
+    }
+
+    {
+        // User-provided memory without growth fails like a fixed arena
+        alignas(16) static std::byte buffer[4096];
+        heap_arena ar {buffer, sizeof(buffer)};
+        std::byte* block {ar.allocate(1024)};
+        CHECK(block > buffer && block < buffer + sizeof(buffer));
+        bool thrown {false};
+        try{
+            [[maybe_unused]] std::byte* too_big {ar.allocate(8192)};
+        }
+        catch(const std::bad_alloc&){
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        // With geometric growth the arena continues in mapped memory
+        heap_arena growing {buffer + 2048, 2048, arena_growth::geometric};
+        std::byte* big {growing.allocate(8192)};
+        CHECK(growing.regions() == 2 && growing.owns(big));
+        growing.deallocate(big);
+        ar.deallocate(block);
+    }
+
+    return test::exit_code();
+}
@@ -5,155 +5,630 @@
 /**
  * Arena class represents the memory arena. Users need to specify the size of the arena as template
  * parameter. Allocators can use this arena for allocating and deallocating arbitrarily sized memory
- * blocks. Arena maintains the list of memory blocks which are in use as well as free memory blocks.
+ * blocks. Free memory blocks are managed with a two-level segregated fit (TLSF) scheme: every block
+ * carries a small header in the arena buffer, free blocks are kept in size-indexed lists located
+ * through two levels of bitmaps, and neighbouring free blocks are merged on deallocation. Both
+ * allocation and deallocation run in bounded time independent of the number of blocks.
+ *
+ * For scratch memory the arena also supports plain bump allocation without any header, together with
+ * markers to rewind the arena to an earlier state and an O(1) reset.
  */
 
 
 
 #include <cstddef>
-#include <list>
 #include <algorithm>
+#include <bit>
 #include <cstdio>
 #include <cstdint>
 #include <memory>
+#include <new>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "mmap_backing.hpp"
 
 /**
- * @brief The block_info class
- * Internal data structure used by arena to maintain information about the allocated and deallocated
- * memory blocks.
+ * @brief The block_header class
+ * Header stored in the arena buffer at the start of every block. Block sizes are multiples of
+ * arena_granularity, the lowest bit of size is used as the free flag. The size includes the header.
+ * Blocks in use hold user data right after the header, free blocks hold their free list links there.
  */
-struct block_info{
-    std::byte* ptr;
-    std::size_t aligned_by;
-    std::size_t count;
-    std::size_t bytes_for_align;
+struct block_header{
+    block_header* prev_phys;
+    std::size_t size;
+};
 
-    bool operator== (const block_info& other) const{
-        return (this->ptr == other.ptr &&
-                this->count == other.count &&
-                this->aligned_by == other.aligned_by &&
-                this->bytes_for_align == other.bytes_for_align);
-    }
+/**
+ * @brief The free_block_links class
+ * Links of a free block in its segregated free list, stored right after the block header.
+ */
+struct free_block_links{
+    block_header* next_free;
+    block_header* prev_free;
+};
 
-    bool operator!= (const block_info& other) const{
-        return !(*this == other);
-    }
+/**
+ * @brief The arena_marker class
+ * Saved state of an arena returned by get_marker() and consumed by rewind().
+ */
+struct arena_marker{
+    std::byte* curr_byte;
+    std::byte* end_byte;
+    block_header* last_block;
+    // Alignment gaps of later blocks are added to last_block
+    std::size_t last_block_size;
+    std::size_t available_bytes;
+    std::size_t occupied_bytes;
 };
 
+constexpr std::size_t arena_granularity {alignof(std::max_align_t) > sizeof(block_header) ? alignof(std::max_align_t) : sizeof(block_header)};
+constexpr std::size_t arena_min_block_size {sizeof(block_header) + sizeof(free_block_links)};
 
+static_assert(arena_granularity % alignof(block_header) == 0, "Blocks must be able to hold a header in place");
 
-template<std::size_t bytes>
-class arena{
-    std::byte buffer[bytes];
+/**
+ * @brief arena_block_size Number of arena bytes used by a block of count bytes with the default alignment
+ */
+constexpr std::size_t arena_block_size(std::size_t count) noexcept {
+    const std::size_t size {(count + sizeof(block_header) + arena_granularity - 1) / arena_granularity * arena_granularity};
+    return size < arena_min_block_size ? arena_min_block_size : size;
+}
+
+
+
+/**
+ * @brief The basic_arena class
+ * TLSF core shared by the arenas. It manages blocks in a region of memory provided by the derived class,
+ * max_bytes bounds the size of a single region and decides the number of first level free lists. Blocks
+ * are carved from the unused tail of the current region [curr_byte, end_byte). An arena which owns several
+ * regions starts a new one with start_region(), blocks of all regions share the same free lists.
+ * The members return nullptr when a request cannot be served, the derived arenas decide how to fail.
+ */
+
+template<std::size_t max_bytes>
+class basic_arena{
+
+    // Second level lists per first level class = 2^sl_index_count_log2
+    constexpr static unsigned sl_index_count_log2 {4};
+    constexpr static unsigned sl_index_count {1u << sl_index_count_log2};
+    // Blocks smaller than small_block_size are linearly mapped to the lists of the first class
+    constexpr static unsigned fl_index_shift {sl_index_count_log2 + std::bit_width(arena_granularity) - 1};
+    constexpr static std::size_t small_block_size {std::size_t{1} << fl_index_shift};
+    constexpr static unsigned fl_index_count {std::bit_width(max_bytes) > fl_index_shift ? std::bit_width(max_bytes) - fl_index_shift + 1 : 1};
+
+    static_assert(fl_index_count <= 64, "First level bitmap overflow");
 
-    std::list<block_info> uselist;
-    std::list<block_info> freelist;
+    constexpr static std::size_t free_flag {1};
 
-    using iter_type = std::list<block_info>::iterator;
+    std::uint64_t fl_bitmap {0};
+    std::uint32_t sl_bitmap[fl_index_count] {};
+    block_header* free_lists[fl_index_count][sl_index_count] {};
 
-    std::size_t available_bytes {bytes};
+protected:
+
+    std::size_t available_bytes;
     std::size_t occupied_bytes {0};
-    std::byte* curr_byte {static_cast<std::byte*>(buffer)};
-    std::byte* end_byte {static_cast<std::byte*>(buffer + bytes)};
+    std::byte* curr_byte;
+    std::byte* end_byte;
+    // Block right below curr_byte, nullptr if no block has been carved
+    block_header* last_block {nullptr};
 
-public:
+    [[no_unique_address]] allocator_stats stats;
 
-    arena() = default;
 
-    // Arena cannot be copied
-    arena(const arena&) = delete;
-	arena& operator= (const arena&) = delete;
+    static std::size_t size_of(const block_header* block) noexcept {
+        return block->size & ~free_flag;
+    }
 
-    // Arena cannot be moved
-    arena(arena&&) = delete;
-    arena& operator= (arena&&) = delete;
+    static bool is_free(const block_header* block) noexcept {
+        return block->size & free_flag;
+    }
 
+    static free_block_links* links_of(block_header* block) noexcept {
+        return reinterpret_cast<free_block_links*>(block + 1);
+    }
+
+    static std::byte* end_of(block_header* block) noexcept {
+        return reinterpret_cast<std::byte*>(block) + size_of(block);
+    }
+
+    static block_header* header_of(std::byte* ptr) noexcept {
+        // Through an integer, the header lies before the object the malloc attributes of allocate() describe
+        return reinterpret_cast<block_header*>(reinterpret_cast<std::uintptr_t>(ptr) - sizeof(block_header));
+    }
+
+    static std::byte* data_of(block_header* block) noexcept {
+        return reinterpret_cast<std::byte*>(block + 1);
+    }
+
+    static block_header* make_block(std::byte* addr, block_header* prev_phys, std::size_t size) noexcept {
+        return ::new(static_cast<void*>(addr)) block_header{prev_phys, size};
+    }
 
     /**
-     * @brief allocate Allocates the storage from arena
-     * @param count Size of block to allocate
-     * @param align Alignment of the block to allocate
-     * @return Address of the allocated block
+     * @brief next_phys Block physically following the block
+     * @return Header of the next block or nullptr if the block is the last one before curr_byte
      */
-	[[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
-    std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+    block_header* next_phys(block_header* block) const noexcept {
+        std::byte* next {end_of(block)};
+        return next == curr_byte ? nullptr : reinterpret_cast<block_header*>(next);
+    }
 
-        if(available_bytes < count)
-            throw std::bad_alloc();
+    /**
+     * @brief mapping Computes the first and second level list indices for a block size
+     */
+    static void mapping(std::size_t size, unsigned& fl, unsigned& sl) noexcept {
+        if(size < small_block_size){
+            fl = 0;
+            sl = static_cast<unsigned>(size / (small_block_size / sl_index_count));
+        }
+        else{
+            const unsigned msb {static_cast<unsigned>(std::bit_width(size)) - 1};
+            sl = static_cast<unsigned>(size >> (msb - sl_index_count_log2)) ^ sl_index_count;
+            fl = msb - fl_index_shift + 1;
+        }
+    }
 
+    /**
+     * @brief find_suitable Finds a free block which can hold at least size bytes
+     * Size is rounded up to the start of the next list, so that any block of the list found is
+     * large enough (good-fit rather than exact best-fit, in exchange for O(1) search).
+     * @return Header of the block or nullptr if no free block is large enough
+     */
+    block_header* find_suitable(std::size_t size) const noexcept {
+        if(size >= small_block_size)
+            size += (std::size_t{1} << (std::bit_width(size) - 1 - sl_index_count_log2)) - 1;
+
+        unsigned fl, sl;
+        mapping(size, fl, sl);
+        if(fl >= fl_index_count)
+            return nullptr;
+
+        std::uint32_t sl_map {sl_bitmap[fl] & (~std::uint32_t{0} << sl)};
+        if(!sl_map){
+            const std::uint64_t fl_map {fl + 1 < 64 ? fl_bitmap & (~std::uint64_t{0} << (fl + 1)) : 0};
+            if(!fl_map)
+                return nullptr;
+            fl = static_cast<unsigned>(std::countr_zero(fl_map));
+            sl_map = sl_bitmap[fl];
+        }
+        sl = static_cast<unsigned>(std::countr_zero(sl_map));
+        return free_lists[fl][sl];
+    }
 
-        if(!std::all_of(freelist.begin(), freelist.end(), [count](const block_info& block){ return block.count < count; })){
+    void insert_free(block_header* block) noexcept {
+        unsigned fl, sl;
+        mapping(size_of(block), fl, sl);
+
+        block->size |= free_flag;
+        free_block_links* links {links_of(block)};
+        links->prev_free = nullptr;
+        // List heads are only valid while their bitmap bit is set, reset() clears the bitmaps alone
+        links->next_free = (sl_bitmap[fl] & (std::uint32_t{1} << sl)) ? free_lists[fl][sl] : nullptr;
+        if(links->next_free)
+            links_of(links->next_free)->prev_free = block;
+        free_lists[fl][sl] = block;
+        fl_bitmap |= std::uint64_t{1} << fl;
+        sl_bitmap[fl] |= std::uint32_t{1} << sl;
+    }
 
-            void* ptr {nullptr};
-            std::size_t bytes_for_align {0};
+    void remove_free(block_header* block) noexcept {
+        unsigned fl, sl;
+        mapping(size_of(block), fl, sl);
+
+        block->size &= ~free_flag;
+        free_block_links* links {links_of(block)};
+        if(links->prev_free)
+            links_of(links->prev_free)->next_free = links->next_free;
+        else
+            free_lists[fl][sl] = links->next_free;
+        if(links->next_free)
+            links_of(links->next_free)->prev_free = links->prev_free;
+
+        if(!free_lists[fl][sl]){
+            sl_bitmap[fl] &= ~(std::uint32_t{1} << sl);
+            if(!sl_bitmap[fl])
+                fl_bitmap &= ~(std::uint64_t{1} << fl);
+        }
+    }
 
-            iter_type matched_block { std::find_if(freelist.begin(), freelist.end(), [count, align, &ptr, &bytes_for_align](block_info& block){
+    /**
+     * @brief alignment_gap Bytes to skip from addr so that the data of a block placed there is aligned
+     * The gap is either zero or large enough to form a free block of its own.
+     */
+    static std::size_t alignment_gap(std::byte* addr, std::size_t align) noexcept {
+        const std::uintptr_t data {reinterpret_cast<std::uintptr_t>(addr) + sizeof(block_header)};
+        std::size_t gap {static_cast<std::size_t>((align - data % align) % align)};
+        while(gap != 0 && gap < arena_min_block_size)
+            gap += align;
+        return gap;
+    }
 
-                if(block.count < count)
-                    return false;
-                ptr = static_cast<void*>(block.ptr);
-                bytes_for_align = block.count;
-                return (std::align(align, count, ptr, bytes_for_align)) ? true : false;
-            })};
+    /**
+     * @brief release_block Returns a block which is not in any list to the free lists, merging it with
+     * its free neighbours. A block adjacent to curr_byte is merged back into the unused tail of the buffer.
+     */
+    void release_block(block_header* block) noexcept {
+
+        if(block_header* prev {block->prev_phys}; prev && is_free(prev)){
+            remove_free(prev);
+            prev->size += size_of(block);
+            if(last_block == block)
+                last_block = prev;
+            block = prev;
+        }
 
-            if(matched_block != freelist.end()){
+        block_header* next {next_phys(block)};
+        if(next == nullptr){
+            curr_byte = reinterpret_cast<std::byte*>(block);
+            last_block = block->prev_phys;
+            return;
+        }
 
-                block_info new_block {static_cast<std::byte*>(ptr), align, count, matched_block->count - bytes_for_align};
-                uselist.push_back(new_block);
-                matched_block->ptr += count;
-                matched_block->count -= count;
-                available_bytes -= count;
-                occupied_bytes += count;
-                return new_block.ptr;
-            }
+        if(is_free(next)){
+            remove_free(next);
+            block->size += size_of(next);
+            if(last_block == next)
+                last_block = block;
+            next = next_phys(block);
         }
+        if(next)
+            next->prev_phys = block;
+        insert_free(block);
+    }
 
-        void* ptr {static_cast<void*>(curr_byte)};
+    /**
+     * @brief split_block Shrinks the block to size bytes and releases the remainder if it can form a block
+     */
+    void split_block(block_header* block, std::size_t size) noexcept {
+        const std::size_t remainder {size_of(block) - size};
+        if(remainder < arena_min_block_size)
+            return;
+
+        block_header* rest {make_block(reinterpret_cast<std::byte*>(block) + size, block, remainder)};
+        block->size = size;
+        if(block_header* next {next_phys(rest)}; next)
+            next->prev_phys = rest;
+        if(last_block == block)
+            last_block = rest;
+        release_block(rest);
+    }
 
-        std::size_t bytes_for_align{available_bytes};
-        ptr = std::align(align, count, ptr, bytes_for_align);
+    /**
+     * @brief carve_block Carves a block from the unused tail of the buffer
+     * @return Header of the block or nullptr if the tail is too small
+     */
+    block_header* carve_block(std::size_t size, std::size_t align) noexcept {
 
-        if(ptr){
+        // Bump allocations leave curr_byte unaligned, blocks always start on the granularity
+        std::size_t pad {0};
+        if(!last_block){
+            const std::uintptr_t addr {reinterpret_cast<std::uintptr_t>(curr_byte)};
+            pad = static_cast<std::size_t>((arena_granularity - addr % arena_granularity) % arena_granularity);
+        }
 
-            std::size_t used_bytes {available_bytes - bytes_for_align};
-            std::byte* next_addr {static_cast<std::byte*>(ptr)};
-            available_bytes -= (count + used_bytes);
-            occupied_bytes += (count + used_bytes);
-            curr_byte = next_addr + count;
-            uselist.push_back(block_info{next_addr, align, count, used_bytes});
-            return next_addr;
+        const std::uintptr_t data {reinterpret_cast<std::uintptr_t>(curr_byte) + pad + sizeof(block_header)};
+        const std::size_t gap {pad + static_cast<std::size_t>((align - data % align) % align)};
+        if(static_cast<std::size_t>(end_byte - curr_byte) < gap + size)
+            return nullptr;
+
+        // The alignment gap is never put in the free lists, a free block past a marker would survive rewind().
+        // It is absorbed by the previous block and released together with it, markers save the size of that
+        // block. Without a previous block the gap is skipped and stays occupied until rewind() or reset().
+        if(gap){
+            if(last_block)
+                last_block->size += gap;
+            available_bytes -= gap;
+            occupied_bytes += gap;
+            stats.record_overhead(gap);
+            curr_byte += gap;
         }
 
-        throw std::bad_alloc();
+        block_header* block {make_block(curr_byte, last_block, size)};
+        curr_byte += size;
+        last_block = block;
+        return block;
     }
 
     /**
-     * @brief deallocate Deallocates the storage
-     * @param ptr Address of the block to deallocate
+     * @brief take_free_block Takes an aligned block out of a free block found by find_suitable
      */
-	[[gnu::nonnull]]
-    void deallocate(std::byte* ptr){
+    block_header* take_free_block(block_header* block, std::size_t size, std::size_t align) noexcept {
+
+        remove_free(block);
+
+        if(const std::size_t gap {alignment_gap(reinterpret_cast<std::byte*>(block), align)}; gap){
+            block_header* aligned {make_block(reinterpret_cast<std::byte*>(block) + gap, block, size_of(block) - gap)};
+            block->size = gap;
+            if(block_header* next {next_phys(aligned)}; next)
+                next->prev_phys = aligned;
+            if(last_block == block)
+                last_block = aligned;
+            insert_free(block);
+            block = aligned;
+        }
 
-        const iter_type block_pos {std::find_if(uselist.begin(), uselist.end(), [&](const block_info& block) -> bool {
-            return block.ptr == ptr;
-        })};
+        split_block(block, size);
+        return block;
+    }
 
-        if(block_pos == uselist.end())
-            return; // Handle the situation appropriately
-        available_bytes += (block_pos->count + block_pos->bytes_for_align);
-        occupied_bytes -= (block_pos->count + block_pos->bytes_for_align);
+    basic_arena(std::byte* begin, std::size_t size) noexcept :
+        available_bytes{size},
+        curr_byte{begin},
+        end_byte{begin + size} {}
+
+    // Blocks point into the arena, it cannot be copied or moved
+    basic_arena(const basic_arena&) = delete;
+    basic_arena& operator= (const basic_arena&) = delete;
+
+    /**
+     * @brief try_allocate Allocates a block with a header from the free lists or the current region
+     * @return Address of the block or nullptr if neither can serve the request
+     */
+    std::byte* try_allocate(std::size_t count, std::size_t align) noexcept {
+
+        if(available_bytes < count)
+            return nullptr;
 
+        align = std::max(align, arena_granularity);
+        const std::size_t size {arena_block_size(count)};
 
-        if(block_pos->ptr + block_pos->count == curr_byte){
-            curr_byte -= (block_pos->count + block_pos->bytes_for_align);
+        // A block found in the free lists must also have room for the worst case alignment gap
+        const std::size_t search_size {align > arena_granularity ? size + align + arena_granularity : size};
+
+        block_header* block {find_suitable(search_size)};
+        block = block ? take_free_block(block, size, align) : carve_block(size, align);
+        if(!block)
+            return nullptr;
+
+        available_bytes -= size_of(block);
+        occupied_bytes += size_of(block);
+        stats.record_allocation(count, size_of(block));
+        trace_allocation(data_of(block), count, align);
+        return data_of(block);
+    }
+
+    /**
+     * @brief release Returns a block allocated with try_allocate to the free lists
+     * The derived arena checks that the address belongs to it.
+     */
+    void release(std::byte* ptr) noexcept {
+
+        block_header* block {header_of(ptr)};
+        if(is_free(block))
+            return; // Double free
+
+        available_bytes += size_of(block);
+        occupied_bytes -= size_of(block);
+        stats.record_deallocation(size_of(block));
+        trace_deallocation(ptr);
+        release_block(block);
+    }
+
+    /**
+     * @brief try_expand_block Grows a block allocated with try_allocate in place
+     * The last block before curr_byte grows into the unused tail of the region, any other block takes the
+     * bytes it needs from the free block physically following it.
+     * @return false if the block cannot hold count bytes without moving
+     */
+    bool try_expand_block(std::byte* ptr, std::size_t count) noexcept {
+
+        block_header* block {header_of(ptr)};
+        const std::size_t old_size {size_of(block)};
+        const std::size_t size {arena_block_size(count)};
+        if(size <= old_size){
+            trace_resize(ptr, count);
+            return true;
+        }
+
+        const std::size_t extra {size - old_size};
+        block_header* next {next_phys(block)};
+        if(next == nullptr){
+            if(static_cast<std::size_t>(end_byte - curr_byte) < extra)
+                return false;
+            block->size += extra;
+            curr_byte += extra;
         }
         else{
-            block_info freeblock{block_pos->ptr - block_pos->bytes_for_align, 0, block_pos->count + block_pos->bytes_for_align, 0};
-            freelist.push_back(std::move(freeblock));
+            if(!is_free(next) || size_of(next) < extra)
+                return false;
+            remove_free(next);
+            block->size += size_of(next);
+            if(last_block == next)
+                last_block = block;
+            if(block_header* after {next_phys(block)}; after)
+                after->prev_phys = block;
+            split_block(block, size);
+        }
+
+        available_bytes -= size_of(block) - old_size;
+        occupied_bytes += size_of(block) - old_size;
+        stats.record_resize(old_size, size_of(block));
+        trace_resize(ptr, count);
+        return true;
+    }
+
+    /**
+     * @brief shrink_block Shrinks a block allocated with try_allocate in place, the released tail is merged
+     * with the free block following it or returned to the unused tail of the region
+     * @return false if the tail is too small to form a block of its own and nothing was released
+     */
+    bool shrink_block(std::byte* ptr, std::size_t count) noexcept {
+
+        block_header* block {header_of(ptr)};
+        const std::size_t old_size {size_of(block)};
+        const std::size_t size {arena_block_size(count)};
+        if(size >= old_size)
+            return false;
+
+        split_block(block, size);
+        if(size_of(block) == old_size)
+            return false;
+
+        available_bytes += old_size - size_of(block);
+        occupied_bytes -= old_size - size_of(block);
+        stats.record_resize(old_size, size_of(block));
+        trace_resize(ptr, count);
+        return true;
+    }
+
+    /**
+     * @brief terminate_blocks Places a used block header at curr_byte, so that the last block never treats
+     * the memory after it as its physical successor
+     * @return false if there is no room for the header
+     */
+    bool terminate_blocks() noexcept {
+        if(!last_block)
+            return true;
+        if(static_cast<std::size_t>(end_byte - curr_byte) < sizeof(block_header))
+            return false;
+        make_block(curr_byte, last_block, sizeof(block_header));
+        curr_byte += sizeof(block_header);
+        available_bytes -= sizeof(block_header);
+        occupied_bytes += sizeof(block_header);
+        stats.record_overhead(sizeof(block_header));
+        last_block = nullptr;
+        return true;
+    }
+
+    /**
+     * @brief try_bump_allocate Allocates a block without a header from the current region
+     * @return Address of the block or nullptr if the current region is too small
+     */
+    std::byte* try_bump_allocate(std::size_t count, std::size_t align) noexcept {
+
+        if(!terminate_blocks())
+            return nullptr;
+
+        void* ptr {static_cast<void*>(curr_byte)};
+        std::size_t space {static_cast<std::size_t>(end_byte - curr_byte)};
+        if(!std::align(align, count, ptr, space))
+            return nullptr;
+
+        std::byte* block {static_cast<std::byte*>(ptr)};
+        const std::size_t used_bytes {static_cast<std::size_t>(block - curr_byte) + count};
+        available_bytes -= used_bytes;
+        occupied_bytes += used_bytes;
+        stats.record_allocation(count, used_bytes);
+        trace_allocation(block, count, align);
+        curr_byte = block + count;
+        return block;
+    }
+
+    /**
+     * @brief start_region Makes [begin, begin + size) the current region
+     * The unused tail of the previous region is abandoned. Its blocks are terminated with a used header,
+     * the caller must have reserved sizeof(block_header) bytes after the end_byte of the previous region.
+     */
+    void start_region(std::byte* begin, std::size_t size) noexcept {
+        if(last_block){
+            make_block(curr_byte, last_block, sizeof(block_header));
+            last_block = nullptr;
         }
-        uselist.remove(*block_pos);
+        available_bytes -= static_cast<std::size_t>(end_byte - curr_byte);
+        available_bytes += size;
+        curr_byte = begin;
+        end_byte = begin + size;
+    }
+
+    /**
+     * @brief drop_free_blocks Removes the free blocks lying in [begin, end) from the free lists
+     * Their memory is being discarded, e.g. resizing blocks allocated after a marker may have left free
+     * blocks past the curr_byte of the marker.
+     */
+    void drop_free_blocks(std::byte* begin, std::byte* end) noexcept {
+        for(std::uint64_t fl_map = fl_bitmap; fl_map; fl_map &= fl_map - 1){
+            const unsigned fl {static_cast<unsigned>(std::countr_zero(fl_map))};
+            for(std::uint32_t sl_map = sl_bitmap[fl]; sl_map; sl_map &= sl_map - 1){
+                block_header* block {free_lists[fl][std::countr_zero(sl_map)]};
+                while(block){
+                    block_header* next {links_of(block)->next_free};
+                    if(reinterpret_cast<std::byte*>(block) >= begin && reinterpret_cast<std::byte*>(block) < end)
+                        remove_free(block);
+                    block = next;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief restore Rewinds the arena to the marker, in O(1) unless the free lists hold blocks
+     */
+    void restore(const arena_marker& marker) noexcept {
+        if(fl_bitmap)
+            drop_free_blocks(marker.curr_byte, marker.end_byte);
+        stats.record_release(occupied_bytes - marker.occupied_bytes);
+        trace_release(marker.curr_byte, marker.end_byte);
+        curr_byte = marker.curr_byte;
+        end_byte = marker.end_byte;
+        last_block = marker.last_block;
+        if(last_block)
+            last_block->size = marker.last_block_size;
+        available_bytes = marker.available_bytes;
+        occupied_bytes = marker.occupied_bytes;
+    }
+
+    /**
+     * @brief clear Empties the free lists and makes [begin, begin + size) the only region
+     */
+    void clear(std::byte* begin, std::size_t size) noexcept {
+        stats.record_release(occupied_bytes);
+        trace_release(begin, begin + size);
+        fl_bitmap = 0;
+        std::fill(std::begin(sl_bitmap), std::end(sl_bitmap), 0);
+        curr_byte = begin;
+        end_byte = begin + size;
+        last_block = nullptr;
+        available_bytes = size;
+        occupied_bytes = 0;
     }
 
+public:
+
+    /**
+     * @brief get_marker Captures the current state of the arena
+     * @return Marker which can be passed to rewind()
+     */
+    arena_marker get_marker() const noexcept {
+        return arena_marker{curr_byte, end_byte, last_block, last_block ? last_block->size : 0, available_bytes, occupied_bytes};
+    }
+
+    /**
+     * @brief trim Returns the whole pages inside free blocks and inside the unused tail of the current region
+     * to the operating system. The header and the free list links at the start of a free block are kept, the
+     * blocks stay in the free lists and their pages are faulted back in when they are reused.
+     * @param advice How the pages are returned
+     * @return Number of resident bytes released
+     */
+    std::size_t trim(decommit_advice advice = decommit_advice::dont_need) noexcept {
+        std::size_t released {decommit(curr_byte, end_byte, advice)};
+        for(std::uint64_t fl_map = fl_bitmap; fl_map; fl_map &= fl_map - 1){
+            const unsigned fl {static_cast<unsigned>(std::countr_zero(fl_map))};
+            for(std::uint32_t sl_map = sl_bitmap[fl]; sl_map; sl_map &= sl_map - 1){
+                block_header* block {free_lists[fl][std::countr_zero(sl_map)]};
+                for(; block; block = links_of(block)->next_free)
+                    released += decommit(reinterpret_cast<std::byte*>(block) + arena_min_block_size, end_of(block), advice);
+            }
+        }
+        return released;
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics
+     * The largest free block is estimated from the highest non-empty free list and the unused tail of the buffer.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        std::size_t largest_free {static_cast<std::size_t>(end_byte - curr_byte)};
+        if(fl_bitmap){
+            const unsigned fl {static_cast<unsigned>(std::bit_width(fl_bitmap)) - 1};
+            const unsigned sl {static_cast<unsigned>(std::bit_width(sl_bitmap[fl])) - 1};
+            largest_free = std::max(largest_free, size_of(free_lists[fl][sl]));
+        }
+        return stats.snapshot(fragmentation_ratio(largest_free, available_bytes));
+    }
+#endif
+
 #ifdef ARENA_BYTE_INFO
     std::size_t get_available_bytes() const {
         return available_bytes;
@@ -166,4 +641,143 @@ public:
 };
 
 
+
+
+/**
+ * @brief The arena_storage class
+ * Buffer of the arena, a base class of arena so that it is in place before basic_arena refers to it.
+ */
+template<std::size_t bytes>
+struct arena_storage{
+    alignas(arena_granularity) std::byte buffer[bytes];
+};
+
+
+/**
+ * @brief The arena class
+ * Arena of a fixed size with the buffer embedded in the object.
+ */
+template<std::size_t bytes>
+class arena : private arena_storage<bytes>, public basic_arena<bytes>{
+
+    using arena_storage<bytes>::buffer;
+    using core = basic_arena<bytes>;
+
+public:
+
+    arena() noexcept : core(buffer, bytes) {}
+
+    // Arena cannot be copied
+    arena(const arena&) = delete;
+	arena& operator= (const arena&) = delete;
+
+    // Arena cannot be moved
+    arena(arena&&) = delete;
+    arena& operator= (arena&&) = delete;
+
+
+    /**
+     * @brief allocate Allocates the storage from arena
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     */
+	[[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        std::byte* ptr {core::try_allocate(count, align)};
+        if(!ptr){
+            this->stats.record_failure();
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    /**
+     * @brief deallocate Deallocates the storage
+     * @param ptr Address of the block to deallocate
+     */
+	[[gnu::nonnull]]
+    void deallocate(std::byte* ptr){
+
+        if(!(ptr > buffer && ptr < this->curr_byte))
+            return; // Handle the situation appropriately
+
+        core::release(ptr);
+    }
+
+    /**
+     * @brief try_expand Grows the block in place, like realloc() without the fallback to a copy
+     * @param ptr Address of a block allocated with allocate()
+     * @param count New size of the block in bytes
+     * @return true if the block now holds count bytes, false if it is unchanged and would have to be moved
+     */
+    bool try_expand(std::byte* ptr, std::size_t count) noexcept {
+        if(!(ptr > buffer && ptr < this->curr_byte))
+            return false;
+        return core::try_expand_block(ptr, count);
+    }
+
+    /**
+     * @brief try_shrink Shrinks the block in place and returns its tail to the arena
+     * @param ptr Address of a block allocated with allocate()
+     * @param count New size of the block in bytes
+     * @return true if memory was released, false if the block is unchanged
+     */
+    bool try_shrink(std::byte* ptr, std::size_t count) noexcept {
+        if(!(ptr > buffer && ptr < this->curr_byte))
+            return false;
+        return core::shrink_block(ptr, count);
+    }
+
+    /**
+     * @brief bump_allocate Allocates the storage from the unused tail of the arena without a block header
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     *
+     * Blocks allocated this way cannot be passed to deallocate(), they are only released by rewind()
+     * or reset().
+     */
+	[[gnu::alloc_align(3), gnu::alloc_size(2), gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* bump_allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        std::byte* ptr {core::try_bump_allocate(count, align)};
+        if(!ptr){
+            this->stats.record_failure();
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    /**
+     * @brief rewind Releases everything allocated after the marker was taken
+     * @param marker Marker returned by get_marker()
+     *
+     * Blocks carved with allocate() after the marker was taken are discarded as well, whether they were
+     * resized or deallocated in the meantime. Rewinding is O(1) while the free lists are empty, otherwise
+     * it walks them. Blocks which were in use when the marker was taken must not be deallocated or resized
+     * before rewinding, and blocks which allocate() takes from the free lists in the meantime are not
+     * released by the rewind, so mix markers with allocate() only while nothing has been deallocated.
+     */
+    void rewind(const arena_marker& marker) noexcept {
+        core::restore(marker);
+    }
+
+    /**
+     * @brief reset Releases all the blocks of the arena and returns it to its initial state
+     */
+    void reset() noexcept {
+        core::clear(buffer, bytes);
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to the arena buffer
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        const std::byte* addr {static_cast<const std::byte*>(ptr)};
+        return addr >= buffer && addr < buffer + bytes;
+    }
+};
+
+
 #endif // STATIC_BUFFER_ARENA_HPP
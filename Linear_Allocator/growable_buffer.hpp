@@ -0,0 +1,177 @@
+#ifndef GROWABLE_BUFFER_HPP
+#define GROWABLE_BUFFER_HPP
+
+
+/**
+ *  The growable_buffer is a vector of trivially copyable elements for append-heavy workloads on a linear
+ *  allocator. Unlike std::vector, which can only allocate a new block and copy, the buffer first tries to
+ *  grow its block in place with try_expand(). The buffer is usually the last block of the arena or followed
+ *  by freed memory, so appending rarely copies and the arena is not littered with the abandoned smaller
+ *  blocks of every growth step.
+ */
+
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+/**
+ * @brief The growable_buffer class
+ * Allocator is basic_linear_allocator in general mode, or any type with the same allocate(count, align),
+ * deallocate(ptr), try_expand(ptr, count) and try_shrink(ptr, count) members. The buffer keeps a copy of the
+ * allocator, copies of a linear allocator share its arena.
+ */
+
+template<typename T, typename Allocator>
+class growable_buffer{
+
+    static_assert(std::is_trivially_copyable_v<T>, "Elements are moved with memcpy");
+
+    constexpr static std::size_t min_capacity {16};
+
+    Allocator alloc;
+    T* elements {nullptr};
+    std::size_t count {0};
+    std::size_t cap {0};
+
+private:
+
+    static std::byte* bytes_of(T* ptr) noexcept {
+        return reinterpret_cast<std::byte*>(ptr);
+    }
+
+    /**
+     * @brief grow Makes room for at least required elements
+     * The capacity is doubled in place if possible, then extended in place to just the required size, and
+     * only then the elements are copied to a new block.
+     */
+    void grow(std::size_t required){
+        if(required > std::size_t(-1) / sizeof(T))
+            throw std::bad_array_new_length();
+
+        const std::size_t preferred {std::max({required, cap * 2, min_capacity})};
+        if(elements){
+            if(alloc.try_expand(bytes_of(elements), preferred * sizeof(T))){
+                cap = preferred;
+                return;
+            }
+            if(alloc.try_expand(bytes_of(elements), required * sizeof(T))){
+                cap = required;
+                return;
+            }
+        }
+
+        T* moved {reinterpret_cast<T*>(alloc.allocate(preferred * sizeof(T), alignof(T)))};
+        if(elements){
+            std::memcpy(moved, elements, count * sizeof(T));
+            alloc.deallocate(bytes_of(elements));
+        }
+        elements = moved;
+        cap = preferred;
+    }
+
+public:
+
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    /**
+     * @brief growable_buffer Converting constructor
+     * @param _alloc Allocator of the buffer memory
+     */
+    explicit growable_buffer(const Allocator& _alloc) : alloc{_alloc} {}
+
+    growable_buffer(growable_buffer&& other) noexcept :
+        alloc{other.alloc},
+        elements{other.elements},
+        count{other.count},
+        cap{other.cap} {
+        other.elements = nullptr;
+        other.count = other.cap = 0;
+    }
+
+    growable_buffer(const growable_buffer&) = delete;
+    growable_buffer& operator= (const growable_buffer&) = delete;
+    growable_buffer& operator= (growable_buffer&&) = delete;
+
+    ~growable_buffer(){
+        if(elements)
+            alloc.deallocate(bytes_of(elements));
+    }
+
+    /**
+     * @brief reserve Makes room for at least new_capacity elements
+     */
+    void reserve(std::size_t new_capacity){
+        if(new_capacity > cap)
+            grow(new_capacity);
+    }
+
+    void push_back(const T& value){
+        if(count == cap)
+            grow(count + 1);
+        elements[count++] = value;
+    }
+
+    /**
+     * @brief append Appends n elements copied from values
+     */
+    void append(const T* values, std::size_t n){
+        if(n > cap - count)
+            grow(count + n);
+        std::memcpy(elements + count, values, n * sizeof(T));
+        count += n;
+    }
+
+    /**
+     * @brief resize Changes the number of elements, new elements are value-initialized
+     */
+    void resize(std::size_t new_count){
+        if(new_count > cap)
+            grow(new_count);
+        std::fill(elements + count, elements + std::max(count, new_count), T{});
+        count = new_count;
+    }
+
+    void clear() noexcept {
+        count = 0;
+    }
+
+    /**
+     * @brief shrink_to_fit Returns the unused capacity to the arena
+     */
+    void shrink_to_fit() noexcept {
+        if(!elements || count == cap)
+            return;
+        if(count == 0){
+            alloc.deallocate(bytes_of(elements));
+            elements = nullptr;
+            cap = 0;
+        }
+        else if(alloc.try_shrink(bytes_of(elements), count * sizeof(T))){
+            cap = count;
+        }
+    }
+
+    T* data() noexcept { return elements; }
+    const T* data() const noexcept { return elements; }
+
+    std::size_t size() const noexcept { return count; }
+    std::size_t capacity() const noexcept { return cap; }
+    bool empty() const noexcept { return count == 0; }
+
+    T& operator[] (std::size_t index) noexcept { return elements[index]; }
+    const T& operator[] (std::size_t index) const noexcept { return elements[index]; }
+
+    iterator begin() noexcept { return elements; }
+    iterator end() noexcept { return elements + count; }
+    const_iterator begin() const noexcept { return elements; }
+    const_iterator end() const noexcept { return elements + count; }
+};
+
+
+#endif // GROWABLE_BUFFER_HPP
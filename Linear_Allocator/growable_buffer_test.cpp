@@ -0,0 +1,85 @@
+#include "growable_buffer.hpp"
+#include "linear_allocator.hpp"
+#include "heap_buffer_arena.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <cstring>
+
+int main(){
+
+    {
+        // The last block grows into the unused tail of the arena and shrinks back
+        static arena<4096> ar;
+        std::byte* block {ar.allocate(100)};
+        std::memset(block, 7, 100);
+        const std::size_t occupied {ar.get_occupied_bytes()};
+        CHECK(ar.try_expand(block, 1000));
+        CHECK(ar.get_occupied_bytes() == occupied + arena_block_size(1000) - arena_block_size(100));
+        CHECK(block[99] == std::byte{7});
+        CHECK(!ar.try_expand(block, 8192));
+        CHECK(ar.try_shrink(block, 100));
+        CHECK(ar.get_occupied_bytes() == occupied);
+        CHECK(!ar.try_shrink(block, 99));
+
+        // A block followed by a block in use cannot grow, a freed neighbour is absorbed
+        std::byte* next {ar.allocate(200)};
+        CHECK(!ar.try_expand(block, 150));
+        ar.deallocate(next);
+        std::byte* guard {ar.allocate(64)};
+        std::byte* middle {ar.allocate(300)};
+        std::byte* tail {ar.allocate(64)};
+        ar.deallocate(middle);
+        CHECK(ar.try_expand(guard, 200));
+        // The rest of the freed neighbour is still available
+        std::byte* reused {ar.allocate(64)};
+        CHECK(reused > guard && reused < tail);
+        ar.deallocate(reused);
+        ar.deallocate(tail);
+        ar.deallocate(guard);
+        ar.deallocate(block);
+        CHECK(ar.get_occupied_bytes() == 0);
+    }
+
+    {
+        // Appending to a buffer which is the last block of the arena never copies
+        static arena<1 << 22> ar;
+        linear_contiguous_allocator<1 << 22> alloc {ar};
+        growable_buffer<int, linear_contiguous_allocator<1 << 22>> buffer {alloc};
+        buffer.push_back(0);
+        const int* first {buffer.data()};
+        for(int i = 1; i < 100000; ++i)
+            buffer.push_back(i);
+        CHECK(buffer.data() == first);
+        CHECK(buffer.size() == 100000 && buffer[99999] == 99999);
+
+        // Once another block follows it the buffer moves, keeping its contents
+        std::byte* blocker {alloc.allocate(16)};
+        int values[1000];
+        for(int i = 0; i < 1000; ++i)
+            values[i] = -i;
+        buffer.reserve(buffer.capacity() + 1);
+        buffer.append(values, 1000);
+        CHECK(buffer.data() != first);
+        CHECK(buffer[99999] == 99999 && buffer[100999] == -999);
+        alloc.deallocate(blocker);
+
+        // Shrinking returns the unused capacity to the arena
+        const std::size_t occupied {alloc.get_occupied_bytes()};
+        buffer.resize(10);
+        buffer.shrink_to_fit();
+        CHECK(buffer.capacity() == 10 && buffer[9] == 9);
+        CHECK(alloc.get_occupied_bytes() < occupied);
+    }
+
+    {
+        // The same on a runtime-sized arena
+        heap_arena ar {64 * 1024};
+        basic_linear_allocator<heap_arena> alloc {ar};
+        growable_buffer<char, basic_linear_allocator<heap_arena>> text {alloc};
+        for(int i = 0; i < 10000; ++i)
+            text.append("line\n", 5);
+        CHECK(text.size() == 50000 && std::memcmp(text.data() + 49995, "line\n", 5) == 0);
+    }
+
+    return test::exit_code();
+}
@@ -5,7 +5,11 @@
 /**
  *  The linear_contiguous_allocator manages the memory arena of the fixed size. It can allocate and
  *  deallocate the memory blocks of arbitrary sizes and alignments. The allocator takes the size of the
- *  memory arena as template parameter and creates the arena with that size.
+ *  memory arena as template parameter and creates the arena with that size. basic_linear_allocator is
+ *  the same allocator over any arena type, e.g. a heap_arena whose size is only known at runtime.
+ *
+ *  In monotonic mode the allocator is a pure bump-pointer allocator meant for scratch memory. Blocks
+ *  carry no metadata and deallocate() does nothing; memory is released in bulk with rewind() or reset().
  */
 
 
@@ -13,40 +17,50 @@
 #include <cstddef>
 #include <new>
 #include <memory>
-#include <list>
 #include <algorithm>
 #include <cstdio>
 #include "static_buffer_arena.hpp"
 
-template<std::size_t N>
-class linear_contiguous_allocator{
+/**
+ * @brief The linear_mode enum
+ * general   - Blocks can be deallocated individually in any order.
+ * monotonic - Blocks are bump allocated and only released in bulk.
+ */
+enum class linear_mode{
+    general,
+    monotonic
+};
 
-    arena<N>& ar;
+template<typename Arena, linear_mode mode = linear_mode::general>
+class basic_linear_allocator{
+
+    Arena& ar;
 
 public:
 
     /**
-     * @brief linear_contiguous_allocator Converting constructor
+     * @brief basic_linear_allocator Converting constructor
      * @param _ar User-provided memory arena to use
      */
-    linear_contiguous_allocator(arena<N>& _ar) : ar{_ar} {}
+    basic_linear_allocator(Arena& _ar) : ar{_ar} {}
 
     /**
-     * @brief linear_contiguous_allocator Copy constructor
+     * @brief basic_linear_allocator Copy constructor
      * @param other
      *
      * The copy constructor will create another instance of allocator but will not create another
      * arena. So there will be multiple allocators which will operate on that arena. Use some kind of
-     * external synchronization if multiple allocators are going to operate on same arena.
+     * external synchronization if multiple allocators are going to operate on same arena, or a
+     * concurrent_arena, which copies on different threads can share without locking.
      */
-    linear_contiguous_allocator(const linear_contiguous_allocator&  other) : ar{other.ar} {}
+    basic_linear_allocator(const basic_linear_allocator&  other) : ar{other.ar} {}
 
     /**
      * @brief operator = Copy Assignment operator has been deleted
      * @param other
      * @return
      */
-    linear_contiguous_allocator<N> & operator= (const linear_contiguous_allocator<N>&  other) = delete;
+    basic_linear_allocator& operator= (const basic_linear_allocator&  other) = delete;
 
     /**
      * @brief allocate Allocates the storage for required size and alignment
@@ -56,20 +70,96 @@ public:
      */
     std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
 
-        if(std::byte* ptr {ar.allocate(count, align)}; ptr)
-            return ptr;
-        throw std::bad_alloc();
+        if constexpr (mode == linear_mode::monotonic){
+            return ar.bump_allocate(count, align);
+        }
+        else{
+            if(std::byte* ptr {ar.allocate(count, align)}; ptr)
+                return ptr;
+            throw std::bad_alloc();
+        }
     }
 
     /**
      * @brief deallocate Deallocates the storage
      * @param ptr Address of the block which has to be deallocated
+     * In monotonic mode individual blocks are not deallocated.
+     */
+    void deallocate([[maybe_unused]] std::byte* ptr){
+        if constexpr (mode == linear_mode::general){
+            if(ptr)
+                ar.deallocate(ptr);
+        }
+    }
+
+    /**
+     * @brief try_expand Grows the block in place without moving it
+     * @param ptr Address of the block
+     * @param count New size of the block in bytes
+     * @return true if the block now holds count bytes. Always false in monotonic mode, blocks carry no size.
+     */
+    bool try_expand([[maybe_unused]] std::byte* ptr, [[maybe_unused]] std::size_t count) noexcept {
+        if constexpr (mode == linear_mode::general)
+            return ar.try_expand(ptr, count);
+        else
+            return false;
+    }
+
+    /**
+     * @brief try_shrink Shrinks the block in place and returns its tail to the arena
+     * @param ptr Address of the block
+     * @param count New size of the block in bytes
+     * @return true if memory was released. Always false in monotonic mode.
      */
-    void deallocate(std::byte* ptr){
-        if(ptr)
-            ar.deallocate(ptr);
+    bool try_shrink([[maybe_unused]] std::byte* ptr, [[maybe_unused]] std::size_t count) noexcept {
+        if constexpr (mode == linear_mode::general)
+            return ar.try_shrink(ptr, count);
+        else
+            return false;
     }
 
+    /**
+     * @brief get_marker Captures the current position of the allocator
+     * @return Marker which can be passed to rewind()
+     *
+     * Only available in monotonic mode. In general mode an allocation made after the marker may reuse a
+     * block freed before it, which the rewind cannot give back.
+     */
+    arena_marker get_marker() const noexcept {
+        static_assert(mode == linear_mode::monotonic, "Markers require linear_mode::monotonic");
+        return ar.get_marker();
+    }
+
+    /**
+     * @brief rewind Releases every block allocated after the marker was taken
+     * @param marker Marker returned by get_marker()
+     */
+    void rewind(const arena_marker& marker) noexcept {
+        static_assert(mode == linear_mode::monotonic, "Markers require linear_mode::monotonic");
+        ar.rewind(marker);
+    }
+
+    /**
+     * @brief reset Releases all the blocks and returns the arena to its initial state in O(1)
+     */
+    void reset() noexcept {
+        ar.reset();
+    }
+
+    /**
+     * @brief trim Returns the free pages of the arena to the operating system
+     * @return Number of resident bytes released
+     */
+    std::size_t trim(decommit_advice advice = decommit_advice::dont_need) noexcept {
+        return ar.trim(advice);
+    }
+
+#ifdef ALLOCATOR_STATS
+    allocator_stats_snapshot get_stats() const noexcept {
+        return ar.get_stats();
+    }
+#endif
+
 #ifdef ARENA_BYTE_INFO
     std::size_t get_available_bytes() const {
         return ar.get_available_bytes();
@@ -82,4 +172,34 @@ public:
 };
 
 
+template<std::size_t N, linear_mode mode = linear_mode::general>
+using linear_contiguous_allocator = basic_linear_allocator<arena<N>, mode>;
+
+
+/**
+ * @brief The scratch_scope class
+ * RAII guard for a scratch frame. It takes a marker of the allocator when constructed and rewinds the
+ * allocator to it when destroyed, releasing everything allocated within the scope. Scopes can be nested,
+ * the allocator must be in monotonic mode.
+ */
+
+template<typename Allocator>
+class scratch_scope{
+
+    Allocator& alloc;
+    const arena_marker marker;
+
+public:
+
+    explicit scratch_scope(Allocator& _alloc) noexcept : alloc{_alloc}, marker{_alloc.get_marker()} {}
+
+    scratch_scope(const scratch_scope&) = delete;
+    scratch_scope& operator= (const scratch_scope&) = delete;
+
+    ~scratch_scope(){
+        alloc.rewind(marker);
+    }
+};
+
+
 #endif // LINEAR_ALLOC_HPP
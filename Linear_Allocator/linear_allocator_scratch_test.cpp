@@ -0,0 +1,52 @@
+#include "linear_allocator.hpp"
+#include <cstring>
+#include <iostream>
+
+template<std::size_t N, linear_mode mode>
+void print_info(const char* label, const linear_contiguous_allocator<N, mode>& alloc){
+    std::cout << "Available bytes " << label << " -> " << alloc.get_available_bytes() << std::endl;
+    std::cout << "Occupied bytes " << label << " -> " << alloc.get_occupied_bytes() << std::endl;
+}
+
+int main(){
+
+
+    arena<4096> ar;
+    linear_contiguous_allocator<4096, linear_mode::monotonic> scratch {ar};
+
+    print_info("before allocations", scratch);
+
+    std::byte* request_data {scratch.allocate(100, 8)};
+    std::memset(request_data, 1, 100);
+    print_info("after request allocation", scratch);
+
+    const std::size_t outer_occupied {scratch.get_occupied_bytes()};
+    std::size_t inner_occupied {0};
+    {
+        scratch_scope outer {scratch};
+        std::byte* frame {scratch.allocate(512)};
+        std::memset(frame, 2, 512);
+        print_info("in outer frame", scratch);
+
+        {
+            scratch_scope inner {scratch};
+            inner_occupied = scratch.get_occupied_bytes();
+            std::byte* nested {scratch.allocate(1024, 64)};
+            std::memset(nested, 3, 1024);
+            print_info("in inner frame", scratch);
+        }
+
+        print_info("after inner frame", scratch);
+        if(scratch.get_occupied_bytes() != inner_occupied)
+            return 1;
+    }
+
+    print_info("after outer frame", scratch);
+    if(scratch.get_occupied_bytes() != outer_occupied || request_data[99] != std::byte{1})
+        return 1;
+
+    scratch.reset();
+    print_info("after reset", scratch);
+
+    return scratch.get_occupied_bytes() == 0 ? 0 : 1;
+}
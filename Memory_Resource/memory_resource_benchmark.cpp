@@ -0,0 +1,122 @@
+#include "memory_resources.hpp"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ *  Compares the memory resource adapters with the standard std::pmr resources. Every workload is run the
+ *  same number of times against every resource. Monotonic resources are released between repetitions,
+ *  which is how they are used in practice.
+ */
+
+constexpr std::size_t arena_bytes {std::size_t{1} << 24};
+constexpr int repetitions {20};
+constexpr int elements {50'000};
+
+using workload_type = std::function<void(std::pmr::memory_resource*)>;
+
+static void vector_growth(std::pmr::memory_resource* res){
+    std::pmr::vector<int> vec {res};
+    for(int i=0; i<elements; i++){
+        vec.push_back(i);
+    }
+}
+
+static void list_fifo(std::pmr::memory_resource* res){
+    std::pmr::list<int> lst {res};
+    for(int i=0; i<elements; i++){
+        lst.push_back(i);
+    }
+    while(!lst.empty()){
+        lst.pop_front();
+    }
+}
+
+static void list_churn(std::pmr::memory_resource* res){
+    std::pmr::list<int> lst {res};
+    for(int round=0; round<10; round++){
+        for(int i=0; i<elements / 10; i++){
+            lst.push_back(i);
+        }
+        for(int i=0; i<elements / 20; i++){
+            lst.pop_front();
+        }
+    }
+}
+
+static void unordered_map_insert(std::pmr::memory_resource* res){
+    std::pmr::unordered_map<int, int> map {res};
+    for(int i=0; i<elements; i++){
+        map.emplace(i, i);
+    }
+    for(int i=0; i<elements; i+=2){
+        map.erase(i);
+    }
+}
+
+static double run(const workload_type& workload, std::pmr::memory_resource* res, const std::function<void()>& release){
+    const auto start {std::chrono::steady_clock::now()};
+    for(int rep=0; rep<repetitions; rep++){
+        workload(res);
+        release();
+    }
+    const std::chrono::duration<double, std::milli> elapsed {std::chrono::steady_clock::now() - start};
+    return elapsed.count() / repetitions;
+}
+
+int main(){
+
+    std::unique_ptr<arena<arena_bytes>> general_arena {new arena<arena_bytes>};
+    std::unique_ptr<arena<arena_bytes>> scratch_arena {new arena<arena_bytes>};
+    pool_allocator<32, 8> pool(arena_bytes);
+
+    std::pmr::monotonic_buffer_resource monotonic;
+    std::pmr::unsynchronized_pool_resource unsync_pool;
+    pool_memory_resource<32, 8> pool_res {pool};
+    arena_memory_resource<arena_bytes> arena_res {*general_arena};
+    linear_memory_resource<arena_bytes, linear_mode::monotonic> linear_res {*scratch_arena};
+
+    const std::function<void()> no_release {[](){}};
+
+    struct resource_entry{
+        const char* name;
+        std::pmr::memory_resource* res;
+        std::function<void()> release;
+    };
+
+    const resource_entry resources[] {
+        {"new_delete_resource", std::pmr::new_delete_resource(), no_release},
+        {"monotonic_buffer_resource", &monotonic, [&monotonic](){ monotonic.release(); }},
+        {"unsynchronized_pool_resource", &unsync_pool, no_release},
+        {"pool_memory_resource", &pool_res, no_release},
+        {"arena_memory_resource", &arena_res, no_release},
+        {"linear_memory_resource", &linear_res, [&linear_res](){ linear_res.allocator().reset(); }},
+    };
+
+    const std::pair<const char*, workload_type> workloads[] {
+        {"vector_growth", vector_growth},
+        {"list_fifo", list_fifo},
+        {"list_churn", list_churn},
+        {"unordered_map", unordered_map_insert},
+    };
+
+    std::printf("%-30s", "resource (ms per run)");
+    for(const auto& [name, workload] : workloads){
+        std::printf("%16s", name);
+    }
+    std::printf("\n");
+
+    for(const resource_entry& entry : resources){
+        std::printf("%-30s", entry.name);
+        for(const auto& [name, workload] : workloads){
+            std::printf("%16.3f", run(workload, entry.res, entry.release));
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+#ifndef MEMORY_RESOURCES_HPP
+#define MEMORY_RESOURCES_HPP
+
+
+/**
+ *  std::pmr::memory_resource adapters over the allocators of this repository, so that they can be used
+ *  with std::pmr containers without templating the container type on an allocator. Every resource takes
+ *  an upstream resource: requests the wrapped allocator cannot serve (wrong size, exhausted memory) are
+ *  forwarded upstream, and deallocations of blocks the wrapped allocator does not own are forwarded as
+ *  well. Resources can therefore be chained, e.g. a pool falling back to an arena falling back to the
+ *  global heap.
+ */
+
+
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include "pool_allocator.hpp"
+#include "static_buffer_arena.hpp"
+#include "linear_allocator.hpp"
+
+
+/**
+ * @brief The pool_memory_resource class
+ * Serves requests which fit into a chunk of the pool, everything else goes upstream.
+ */
+
+template<std::size_t chk_size, std::size_t chk_align, free_order order = free_order::lifo, chunk_init init = chunk_init::none>
+class pool_memory_resource : public std::pmr::memory_resource{
+
+    pool_allocator<chk_size, chk_align, order, init>& pool;
+    std::pmr::memory_resource* upstream;
+
+public:
+
+    /**
+     * @brief pool_memory_resource Converting constructor
+     * @param _pool Pool to allocate from. It must outlive the resource.
+     * @param _upstream Resource used for requests the pool cannot serve
+     */
+    explicit pool_memory_resource(pool_allocator<chk_size, chk_align, order, init>& _pool,
+                                  std::pmr::memory_resource* _upstream = std::pmr::get_default_resource()) noexcept :
+        pool{_pool}, upstream{_upstream} {}
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+        return upstream;
+    }
+
+protected:
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if(bytes <= chk_size && alignment <= chk_align){
+            if(std::byte* ptr {pool.allocate()}; ptr)
+                return ptr;
+        }
+        return upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override {
+        if(pool.owns(ptr))
+            pool.deallocate(static_cast<std::byte*>(ptr));
+        else
+            upstream->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+
+/**
+ * @brief The arena_memory_resource class
+ * Serves requests from the arena until it is exhausted, then from upstream.
+ */
+
+template<std::size_t bytes>
+class arena_memory_resource : public std::pmr::memory_resource{
+
+    arena<bytes>& ar;
+    std::pmr::memory_resource* upstream;
+
+public:
+
+    /**
+     * @brief arena_memory_resource Converting constructor
+     * @param _ar Arena to allocate from. It must outlive the resource.
+     * @param _upstream Resource used when the arena is exhausted
+     */
+    explicit arena_memory_resource(arena<bytes>& _ar,
+                                   std::pmr::memory_resource* _upstream = std::pmr::get_default_resource()) noexcept :
+        ar{_ar}, upstream{_upstream} {}
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+        return upstream;
+    }
+
+protected:
+
+    void* do_allocate(std::size_t count, std::size_t alignment) override {
+        try{
+            return ar.allocate(count, alignment);
+        }
+        catch(const std::bad_alloc&){
+            return upstream->allocate(count, alignment);
+        }
+    }
+
+    void do_deallocate(void* ptr, std::size_t count, std::size_t alignment) override {
+        if(ar.owns(ptr))
+            ar.deallocate(static_cast<std::byte*>(ptr));
+        else
+            upstream->deallocate(ptr, count, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+
+/**
+ * @brief The linear_memory_resource class
+ * Serves requests through a linear_contiguous_allocator until its arena is exhausted, then from upstream.
+ * With a monotonic allocator this behaves like std::pmr::monotonic_buffer_resource, with the addition of
+ * markers and rewinding through the wrapped allocator.
+ */
+
+template<std::size_t N, linear_mode mode = linear_mode::general>
+class linear_memory_resource : public std::pmr::memory_resource{
+
+    linear_contiguous_allocator<N, mode> alloc;
+    arena<N>& ar;
+    std::pmr::memory_resource* upstream;
+
+public:
+
+    /**
+     * @brief linear_memory_resource Converting constructor
+     * @param _ar Arena used by the allocator. It must outlive the resource.
+     * @param _upstream Resource used when the arena is exhausted
+     */
+    explicit linear_memory_resource(arena<N>& _ar,
+                                    std::pmr::memory_resource* _upstream = std::pmr::get_default_resource()) noexcept :
+        alloc{_ar}, ar{_ar}, upstream{_upstream} {}
+
+    std::pmr::memory_resource* upstream_resource() const noexcept {
+        return upstream;
+    }
+
+    /**
+     * @brief allocator Wrapped allocator, e.g. to take markers or reset it
+     */
+    linear_contiguous_allocator<N, mode>& allocator() noexcept {
+        return alloc;
+    }
+
+protected:
+
+    void* do_allocate(std::size_t count, std::size_t alignment) override {
+        try{
+            return alloc.allocate(count, alignment);
+        }
+        catch(const std::bad_alloc&){
+            return upstream->allocate(count, alignment);
+        }
+    }
+
+    void do_deallocate(void* ptr, std::size_t count, std::size_t alignment) override {
+        if(ar.owns(ptr))
+            alloc.deallocate(static_cast<std::byte*>(ptr));
+        else
+            upstream->deallocate(ptr, count, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+
+#endif // MEMORY_RESOURCES_HPP
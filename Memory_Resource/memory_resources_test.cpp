@@ -0,0 +1,50 @@
+#include "memory_resources.hpp"
+#include <iostream>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+int main(){
+
+    // Chain: pool (small nodes) -> arena (everything else) -> global heap
+    static arena<16 * 1024> ar;
+    pool_allocator<32, 8> pool(32 * 64);
+
+    arena_memory_resource<16 * 1024> arena_res {ar};
+    pool_memory_resource<32, 8> pool_res {pool, &arena_res};
+
+    {
+        std::pmr::list<int> lst {&pool_res};
+        for(int i=0; i<100; i++){
+            lst.push_back(i);
+        }
+        std::cout << "List nodes served by the pool: " << pool.allocated_chunks() << std::endl;
+
+        std::pmr::vector<int> vec {&pool_res};
+        for(int i=0; i<1000; i++){
+            vec.push_back(i);
+        }
+        std::cout << "Vector elements: " << vec.size() << ", sum of list: ";
+        long sum {0};
+        for(int i : lst){
+            sum += i;
+        }
+        std::cout << sum << std::endl;
+    }
+    std::cout << "Pool chunks in use after containers are gone: " << pool.allocated_chunks() << std::endl;
+
+    // Monotonic scratch resource with rewinding
+    static arena<8 * 1024> scratch_arena;
+    linear_memory_resource<8 * 1024, linear_mode::monotonic> scratch {scratch_arena};
+    {
+        scratch_scope frame {scratch.allocator()};
+        std::pmr::map<int, std::pmr::string> map {&scratch};
+        for(int i=0; i<50; i++){
+            map.emplace(i, "value number " + std::to_string(i));
+        }
+        std::cout << "map[42] = " << map.at(42) << std::endl;
+    }
+
+    return pool.allocated_chunks() == 0 ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+#ifndef COMPACT_POOL_ALLOCATOR_HPP
+#define COMPACT_POOL_ALLOCATOR_HPP
+
+
+/*
+ *  Compact Pool Allocator is a pool_allocator whose free list links are 32-bit or 16-bit chunk indices relative
+ *  to the start of the buffer instead of raw pointers. Chunks only need to be as large as the index, so pools
+ *  of 4-byte handles or 2-byte values need no padding to 8 bytes, and more chunks share a cache line. The free
+ *  list holds no addresses, a pool over a user-provided buffer keeps working after the buffer is moved.
+ */
+
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "chunk_init.hpp"
+#include "mmap_backing.hpp"
+
+
+/**
+ * @brief The compact_pool_allocator class
+ * Chunk i starts at base + i * chunk_stride. When chunk_stride is a power of two, index and address are
+ * converted with shifts computed at compile time. A free chunk stores the index of the next free chunk in its
+ * first sizeof(index_type) bytes, the largest index value marks the end of the list, so the pool holds at
+ * most 2^32 - 1 or 2^16 - 1 chunks; a larger buffer is only used up to that number of chunks. Links are
+ * copied with memcpy, chunks need no alignment beyond chk_align.
+ *
+ * Chunks are handed out in LIFO order and carved lazily from the front of the buffer, like pool_allocator.
+ * index_of() and address_of() let the users store 4-byte or 2-byte handles instead of pointers.
+ */
+
+template<std::size_t chk_size, std::size_t chk_align = 1, typename index_type = std::uint32_t, chunk_init init = chunk_init::none>
+class compact_pool_allocator{
+
+    static_assert(std::same_as<index_type, std::uint32_t> || std::same_as<index_type, std::uint16_t>, "Links are 32-bit or 16-bit indices");
+    static_assert(chk_size >= sizeof(index_type), "Chunk must be able to hold the index of the next free chunk");
+    static_assert(std::has_single_bit(chk_align), "Alignment must be a power of two");
+
+    // Distance between two consecutive chunks in the buffer
+    constexpr static std::size_t chunk_stride {(chk_size + chk_align - 1) / chk_align * chk_align};
+    constexpr static bool stride_is_pow2 {std::has_single_bit(chunk_stride)};
+    constexpr static unsigned stride_shift {static_cast<unsigned>(std::countr_zero(chunk_stride))};
+    constexpr static index_type end_index {std::numeric_limits<index_type>::max()};
+
+    void* mem_buffer;
+    std::size_t mapped_bytes {0}; // Length of the mapping owned by the pool, 0 for a user-provided buffer
+    std::byte* base;              // First chunk, mem_buffer aligned to chk_align
+    index_type head {end_index};
+    index_type carve_next {0};    // First chunk which has never been handed out
+    index_type total_chunks {0};
+    index_type free_chunks {0};
+
+    [[no_unique_address]] allocator_stats stats;
+
+private:
+
+    static index_type read_link(const std::byte* chunk) noexcept {
+        index_type next;
+        std::memcpy(&next, chunk, sizeof(next));
+        return next;
+    }
+
+    static void write_link(std::byte* chunk, index_type next) noexcept {
+        std::memcpy(chunk, &next, sizeof(next));
+    }
+
+    /**
+     * @brief offset_of Byte offset of the address from the first chunk
+     */
+    std::size_t offset_of(const void* ptr) const noexcept {
+        return static_cast<std::size_t>(static_cast<const std::byte*>(ptr) - base);
+    }
+
+    /**
+     * @brief compact_pool_allocator Takes ownership of a mapping created by map_backing
+     */
+    compact_pool_allocator(const backing_region& region, std::size_t buffer_size) :
+        compact_pool_allocator(region.address, buffer_size) {
+        mapped_bytes = region.bytes;
+    }
+
+public:
+
+    /**
+     * @brief compact_pool_allocator Default constructor
+     * Manages the memory equivalent to system page size.
+     */
+    compact_pool_allocator() :
+        compact_pool_allocator(static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))) {}
+
+    /**
+     * @brief compact_pool_allocator Converting constructor
+     * @param buffer_size Size of the memory buffer in bytes, mapped by the allocator and released when the
+     * allocator is destroyed
+     * @param backing Backing options of the mapping
+     */
+    explicit compact_pool_allocator(std::size_t buffer_size, const mmap_backing& backing = {}) :
+        compact_pool_allocator(map_backing(buffer_size, backing), buffer_size) {}
+
+    /**
+     * @brief compact_pool_allocator Converting constructor
+     * Manages the user-provided memory buffer, construction does not touch the buffer.
+     * @param buffer Starting address of memory buffer.
+     * @param buffer_size Size of memory buffer in bytes.
+     */
+    compact_pool_allocator(void* buffer, std::size_t buffer_size) :
+        mem_buffer{buffer} {
+
+        if(mem_buffer == MAP_FAILED || mem_buffer == nullptr)
+            throw std::bad_alloc();
+
+        void* start {mem_buffer};
+        std::size_t space {buffer_size};
+        if(!std::align(chk_align, chk_size, start, space))
+            throw std::logic_error("Buffer is too small to hold a chunk");
+
+        base = static_cast<std::byte*>(start);
+        const std::size_t chunks {(space - chk_size) / chunk_stride + 1};
+        total_chunks = static_cast<index_type>(std::min<std::size_t>(chunks, end_index));
+        free_chunks = total_chunks;
+    }
+
+    // Pool owns the mapping, it cannot be copied
+    compact_pool_allocator(const compact_pool_allocator&) = delete;
+    compact_pool_allocator& operator= (const compact_pool_allocator&) = delete;
+
+    ~compact_pool_allocator(){
+        if(mapped_bytes)
+            munmap(mem_buffer, mapped_bytes);
+    }
+
+    /**
+     * @brief allocate Allocates new chunk
+     * @return Address of allocated memory chunk or nullptr if the pool is exhausted
+     */
+    [[gnu::malloc]] [[nodiscard]]
+    std::byte* allocate() noexcept(init != chunk_init::poison) {
+        std::byte* chunk;
+        if(head != end_index){
+            chunk = address_of(head);
+            head = read_link(chunk);
+            init_chunk<init>(chunk, chk_size, true, sizeof(index_type));
+        }
+        else if(carve_next != total_chunks){
+            chunk = address_of(carve_next++);
+            init_chunk<init>(chunk, chk_size, false, 0);
+        }
+        else{
+            stats.record_failure();
+            return nullptr;
+        }
+        --free_chunks;
+        stats.record_allocation(chk_size, chunk_stride);
+        trace_allocation(chunk, chk_size, chk_align);
+        return chunk;
+    }
+
+    /**
+     * @brief deallocate Takes chunk address as input and deallocates that chunk.
+     * @param ptr Address of the chunk to deallocate, it must be the start of a chunk of the pool
+     */
+    [[gnu::nonnull]]
+    void deallocate(std::byte* ptr){
+        if(!owns(ptr) || offset_of(ptr) % chunk_stride != 0)
+            throw std::logic_error("Invalid Address");
+        release_chunk<init>(ptr, chk_size);
+        write_link(ptr, head);
+        head = index_of(ptr);
+        ++free_chunks;
+        stats.record_deallocation(chunk_stride);
+        trace_deallocation(ptr);
+    }
+
+    /**
+     * @brief address_of Address of the chunk with the index
+     */
+    std::byte* address_of(index_type index) const noexcept {
+        if constexpr (stride_is_pow2)
+            return base + (std::size_t{index} << stride_shift);
+        else
+            return base + std::size_t{index} * chunk_stride;
+    }
+
+    /**
+     * @brief index_of Index of the chunk starting at the address, a handle which stays valid when the
+     * buffer is relocated
+     */
+    index_type index_of(const void* ptr) const noexcept {
+        if constexpr (stride_is_pow2)
+            return static_cast<index_type>(offset_of(ptr) >> stride_shift);
+        else
+            return static_cast<index_type>(offset_of(ptr) / chunk_stride);
+    }
+
+    /**
+     * @brief relocate Moves the pool to a copy of its buffer
+     * @param buffer Starting address of the copy. The whole buffer must have been copied there, and the copy
+     * must have the same alignment relative to chk_align as the original buffer.
+     * Pools which mapped their own memory cannot be relocated.
+     */
+    void relocate(void* buffer){
+        if(mapped_bytes)
+            throw std::logic_error("Mapped pool cannot be relocated");
+        std::byte* moved {static_cast<std::byte*>(buffer) + (base - static_cast<std::byte*>(mem_buffer))};
+        if(reinterpret_cast<std::uintptr_t>(moved) % chk_align)
+            throw std::logic_error("Relocated buffer is not aligned like the original");
+        mem_buffer = buffer;
+        base = moved;
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to the chunks of the pool
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        const std::byte* addr {static_cast<const std::byte*>(ptr)};
+        return addr >= base && addr < base + std::size_t{total_chunks} * chunk_stride;
+    }
+
+    /**
+     * @brief available_chunks
+     * @return Total number of available chunks
+     */
+    std::size_t available_chunks() const noexcept {
+        return free_chunks;
+    }
+
+    /**
+     * @brief allocated_chunks
+     * @return Total number of allocated chunks
+     */
+    std::size_t allocated_chunks() const noexcept {
+        return std::size_t{total_chunks} - free_chunks;
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics
+     * Chunks are interchangeable, so the pool never reports fragmentation.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        return stats.snapshot();
+    }
+#endif
+};
+
+
+#endif // COMPACT_POOL_ALLOCATOR_HPP
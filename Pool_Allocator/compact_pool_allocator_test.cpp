@@ -0,0 +1,103 @@
+#include "compact_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+int main(){
+
+    {
+        // 4-byte handles are packed without padding
+        compact_pool_allocator<4, 4> pool(4 * 1000);
+        std::vector<std::byte*> chunks;
+        while(std::byte* chunk = pool.allocate())
+            chunks.push_back(chunk);
+        CHECK(chunks.size() == 1000);
+        CHECK(chunks[1] - chunks[0] == 4);
+        CHECK(pool.available_chunks() == 0);
+
+        for(std::size_t i = 0; i < chunks.size(); ++i){
+            CHECK(pool.index_of(chunks[i]) == i);
+            CHECK(pool.address_of(static_cast<std::uint32_t>(i)) == chunks[i]);
+        }
+
+        // Freed chunks are handed out again in LIFO order
+        pool.deallocate(chunks[10]);
+        pool.deallocate(chunks[500]);
+        CHECK(pool.allocate() == chunks[500]);
+        CHECK(pool.allocate() == chunks[10]);
+
+        // Addresses inside a chunk or outside the pool are rejected
+        bool thrown {false};
+        try{
+            pool.deallocate(chunks[3] + 1);
+        }
+        catch(const std::logic_error&){
+            thrown = true;
+        }
+        CHECK(thrown);
+
+        for(std::byte* chunk : chunks)
+            pool.deallocate(chunk);
+        CHECK(pool.allocated_chunks() == 0);
+    }
+
+    {
+        // 16-bit links cap the pool at 2^16 - 1 chunks of 2 bytes
+        compact_pool_allocator<2, 2, std::uint16_t> pool(2 * 100000);
+        std::set<std::byte*> unique;
+        while(std::byte* chunk = pool.allocate())
+            unique.insert(chunk);
+        CHECK(unique.size() == 65535);
+        for(std::byte* chunk : unique)
+            pool.deallocate(chunk);
+        CHECK(pool.available_chunks() == 65535);
+    }
+
+    {
+        // Odd strides use multiplication, the free list survives moving the buffer
+        alignas(4) static std::byte first[12 * 64];
+        alignas(4) static std::byte second[12 * 64];
+        compact_pool_allocator<12, 4> pool(first, sizeof(first));
+        std::byte* chunks[64];
+        for(auto& chunk : chunks){
+            chunk = pool.allocate();
+            std::memset(chunk, 0x11, 12);
+        }
+        CHECK(chunks[63] - chunks[0] == 63 * 12);
+        for(int i = 0; i < 64; i += 2)
+            pool.deallocate(chunks[i]);
+
+        std::memcpy(second, first, sizeof(first));
+        std::memset(first, 0, sizeof(first));
+        pool.relocate(second);
+
+        std::set<std::uint32_t> reused;
+        while(std::byte* chunk = pool.allocate()){
+            CHECK(chunk >= second && chunk < second + sizeof(second));
+            reused.insert(pool.index_of(chunk));
+        }
+        CHECK(reused.size() == 32 && *reused.begin() == 0 && *reused.rbegin() == 62);
+        CHECK(pool.address_of(1)[0] == std::byte{0x11});
+    }
+
+    {
+        // The chunk initialization policies only spare the link bytes
+        compact_pool_allocator<8, 4, std::uint32_t, chunk_init::poison> pool(8 * 4);
+        std::byte* chunk {pool.allocate()};
+        pool.deallocate(chunk);
+        chunk[6] = std::byte{0};
+        bool detected {false};
+        try{
+            [[maybe_unused]] std::byte* reused {pool.allocate()};
+        }
+        catch(const std::logic_error&){
+            detected = true;
+        }
+        CHECK(detected);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,60 @@
+#include "benchmark_common.hpp"
+#include "compact_pool_allocator.hpp"
+#include "pool_allocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/*
+ *  Footprint and speed of pools of 4-byte objects. pool_allocator pads every chunk to the 8-byte mem_chunk,
+ *  compact_pool_allocator links free chunks with 32-bit indices and packs them at 4 bytes. Every case fills
+ *  the pool, then frees and reallocates random chunks. Peak RSS shows the memory of the pool, handles are
+ *  kept as 32-bit indices for the compact pool and as pointers for pool_allocator. Usage:
+ *
+ *      compact_pool_benchmark [--quick]
+ */
+
+template<typename Pool, typename Handle>
+bench::result run_case(const char* name, std::size_t chunks, std::size_t steps, std::size_t chunk_bytes){
+
+    Pool pool(chunks * chunk_bytes);
+    std::vector<Handle> handles(chunks);
+    std::mt19937_64 rng {99};
+
+    const bench::timer time;
+    for(auto& handle : handles){
+        std::byte* chunk {pool.allocate()};
+        std::memset(chunk, 1, 4);
+        if constexpr (sizeof(Handle) == 4)
+            handle = pool.index_of(chunk);
+        else
+            handle = chunk;
+    }
+    for(std::size_t step = 0; step < steps; ++step){
+        Handle& handle {handles[rng() % chunks]};
+        if constexpr (sizeof(Handle) == 4){
+            pool.deallocate(pool.address_of(handle));
+            handle = pool.index_of(pool.allocate());
+        }
+        else{
+            pool.deallocate(handle);
+            handle = pool.allocate();
+        }
+    }
+    bench::do_not_optimize(handles.data());
+
+    return bench::result{"compact_pool", name, "fill_and_churn", chunks + steps * 2, time.seconds()};
+}
+
+int main(int argc, char* argv[]){
+
+    const bool quick {argc > 1 && std::strcmp(argv[1], "--quick") == 0};
+    const std::size_t chunks {quick ? std::size_t{1} << 16 : std::size_t{1} << 25};
+    const std::size_t steps {quick ? std::size_t{1} << 16 : std::size_t{1} << 24};
+
+    bool ok {true};
+    ok &= bench::run_isolated([&]{ return run_case<pool_allocator<8, 8>, std::byte*>("pool_allocator", chunks, steps, 8); });
+    ok &= bench::run_isolated([&]{ return run_case<compact_pool_allocator<4, 4>, std::uint32_t>("compact_pool_allocator", chunks, steps, 4); });
+    return ok ? 0 : 1;
+}
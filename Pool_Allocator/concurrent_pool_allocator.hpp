@@ -0,0 +1,372 @@
+#ifndef CONCURRENT_POOL_ALLOCATOR_HPP
+#define CONCURRENT_POOL_ALLOCATOR_HPP
+
+
+/*
+ *  Concurrent Pool Allocator is the thread-safe counterpart of pool_allocator. Any number of threads can
+ *  allocate and deallocate chunks from the same pool without external locking. The free list is a lock-free
+ *  (Treiber) stack threaded through the same intrusive mem_chunk layout used by pool_allocator.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "chunk_init.hpp"
+#include "mmap_backing.hpp"
+#include "pool_allocator.hpp"
+
+
+/**
+ * @brief The concurrent_pool_allocator class
+ * The head of the free list is a single 64-bit word which packs the index of the first free chunk (low 32 bits)
+ * together with a version tag (high 32 bits). Every successful update of the head increments the tag, so a
+ * compare-and-swap which observed a stale head fails even if the same chunk has been popped and pushed back in
+ * the meantime (ABA problem). Because chunks are addressed by index, the head fits in a word which is lock-free
+ * on every 64-bit platform without requiring a double-width CAS.
+ *
+ * The chunks still store a raw mem_chunk* link, so the memory layout of free chunks is identical to pool_allocator.
+ * The pool can therefore hold at most 2^32 - 1 chunks.
+ */
+
+template<std::size_t chk_size = sizeof(mem_chunk), std::size_t chk_align = alignof(mem_chunk), chunk_init init = chunk_init::none>
+class concurrent_pool_allocator{
+
+
+    using chunk_type = mem_chunk;
+    static_assert(chk_size >= sizeof(chunk_type), "Chunk size must be 8 bytes minimum");
+    static_assert(chk_align >= alignof(chunk_type), "Chunk must atleast be 8-byte aligned");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free");
+
+    // Distance between two consecutive chunks in the buffer
+    constexpr static std::size_t chunk_stride = (chk_size + chk_align - 1) / chk_align * chk_align;
+    constexpr static std::uint64_t index_mask = std::numeric_limits<std::uint32_t>::max();
+
+    // Head and counters are written by every thread, keep them off the cache line of the
+    // read-only members below.
+    alignas(64) std::atomic<std::uint64_t> head {0};
+    std::atomic<std::size_t> free_chunks {0};
+    std::atomic<std::uint64_t> carved_chunks {0}; // Chunks handed out at least once, carved from the front of the buffer
+    [[no_unique_address]] concurrent_allocator_stats stats;
+
+    alignas(64) void* mem_buffer;
+    std::size_t mem_buffer_size;
+    std::size_t mapped_bytes {0}; // Length of the mapping owned by the pool, 0 for a user-provided buffer
+
+    std::byte* buf_start;
+    std::size_t buf_length;
+    std::size_t total_chunks {0};
+
+private:
+
+    /**
+     * @brief chunk_at Converts a free list index into chunk address.
+     * @param index One-based chunk index, zero represents the end of the list.
+     */
+    chunk_type* chunk_at(std::uint64_t index) const noexcept {
+        return index ? reinterpret_cast<chunk_type*>(buf_start + (index - 1) * chunk_stride) : nullptr;
+    }
+
+    /**
+     * @brief index_of Converts a chunk address into one-based free list index.
+     */
+    std::uint64_t index_of(const chunk_type* chunk) const noexcept {
+        return chunk ? static_cast<std::uint64_t>((reinterpret_cast<const std::byte*>(chunk) - buf_start) / chunk_stride) + 1 : 0;
+    }
+
+    /**
+     * @brief is_chunk Checks whether the address is the start of a chunk of the buffer.
+     */
+    bool is_chunk(const chunk_type* chunk) const noexcept {
+        const std::byte* addr {reinterpret_cast<const std::byte*>(chunk)};
+        return addr >= buf_start && addr < buf_start + buf_length && (addr - buf_start) % chunk_stride == 0;
+    }
+
+    static std::uint64_t make_head(std::uint64_t index, std::uint64_t tag) noexcept {
+        return (tag << 32) | (index & index_mask);
+    }
+
+    /**
+     * @brief allocate_chunk Pops the chunk at the beginning of the list, or carves a new one if the list is empty.
+     * @return Address of the removed chunk or nullptr if the pool is exhausted.
+     */
+    [[nodiscard]]
+    std::byte* allocate_chunk() noexcept(init != chunk_init::poison) {
+        std::uint64_t old_head {head.load(std::memory_order_acquire)};
+        chunk_type* node;
+        while(true){
+            node = chunk_at(old_head & index_mask);
+            if(node == nullptr)
+                return carve_chunk();
+
+            // The chunk may have been popped and handed out by another thread since the head was read, in which
+            // case the link is garbage. The tag makes the following CAS fail in that case.
+            chunk_type* next {std::atomic_ref<chunk_type*>(node->next).load(std::memory_order_relaxed)};
+            const std::uint64_t new_head {make_head(index_of(next), (old_head >> 32) + 1)};
+            if(head.compare_exchange_weak(old_head, new_head, std::memory_order_acquire, std::memory_order_acquire))
+                break;
+        }
+        free_chunks.fetch_sub(1, std::memory_order_relaxed);
+        init_chunk<init>(node, chk_size, true, sizeof(chunk_type));
+        return reinterpret_cast<std::byte*>(node);
+    }
+
+    /**
+     * @brief carve_chunk Takes a chunk which has never been used from the front of the buffer.
+     * @return Address of the chunk or nullptr if the whole buffer has been carved.
+     */
+    [[nodiscard]]
+    std::byte* carve_chunk() noexcept(init != chunk_init::poison) {
+        std::uint64_t index {carved_chunks.load(std::memory_order_relaxed)};
+        do{
+            if(index >= total_chunks)
+                return nullptr;
+        }while(!carved_chunks.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+        free_chunks.fetch_sub(1, std::memory_order_relaxed);
+        chunk_type* node {chunk_at(index + 1)};
+        init_chunk<init>(node, chk_size, false, 0);
+        return reinterpret_cast<std::byte*>(node);
+    }
+
+    /**
+     * @brief deallocate_chunk Pushes the chunk to the front of the list.
+     * @param ptr Starting address of the chunk to be deallocated, already checked to be a chunk of the buffer
+     */
+    [[gnu::nonnull]]
+    void deallocate_chunk(std::byte* ptr) noexcept {
+        // The link may still be read by a thread holding a stale head, only poison the bytes after it
+        release_chunk<init>(ptr + sizeof(chunk_type), chk_size - sizeof(chunk_type));
+        chunk_type* chunk {reinterpret_cast<chunk_type*>(ptr)};
+        const std::uint64_t index {index_of(chunk)};
+        std::uint64_t old_head {head.load(std::memory_order_relaxed)};
+        do{
+            std::atomic_ref<chunk_type*>(chunk->next).store(chunk_at(old_head & index_mask), std::memory_order_relaxed);
+        }while(!head.compare_exchange_weak(old_head, make_head(index, (old_head >> 32) + 1), std::memory_order_release, std::memory_order_relaxed));
+        free_chunks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief concurrent_pool_allocator Takes ownership of a mapping created by map_backing
+     */
+    concurrent_pool_allocator(const backing_region& region, const std::size_t& buffer_size) :
+        concurrent_pool_allocator(region.address, buffer_size) {
+        mapped_bytes = region.bytes;
+    }
+
+public:
+
+    /**
+     * @brief concurrent_pool_allocator Default constructor
+     * Manages the memory equivalent to system page size.
+     */
+    concurrent_pool_allocator() :
+        concurrent_pool_allocator(sysconf(_SC_PAGE_SIZE)) {}
+
+    /**
+     * @brief concurrent_pool_allocator Converting constructor
+     * Maps an anonymous memory region of the required size. The region is unmapped when the pool is destroyed.
+     * @param buffer_size Size of the memory buffer in bytes.
+     */
+    explicit concurrent_pool_allocator(const std::size_t& buffer_size) :
+        concurrent_pool_allocator(buffer_size, mmap_backing{}) {}
+
+    /**
+     * @brief concurrent_pool_allocator Converting constructor
+     * Maps the memory with the requested page size, pre-faulting and NUMA placement.
+     * @param buffer_size Size of the memory buffer in bytes. The mapping may be rounded up to the huge
+     * page size, the pool only carves chunks out of the first buffer_size bytes.
+     * @param backing Backing options of the mapping
+     */
+    concurrent_pool_allocator(const std::size_t& buffer_size, const mmap_backing& backing) :
+        concurrent_pool_allocator(map_backing(buffer_size, backing), buffer_size) {}
+
+    /**
+     * @brief concurrent_pool_allocator Converting constructor
+     * Manages the user-provided memory buffer.
+     * @param buffer Starting address of memory buffer.
+     * @param buffer_size Size of memory buffer in bytes.
+     */
+    concurrent_pool_allocator(void* buffer, const std::size_t& buffer_size) :
+        mem_buffer{buffer},
+        mem_buffer_size{buffer_size} {
+
+        if(mem_buffer == MAP_FAILED || mem_buffer == nullptr)
+            throw std::bad_alloc();
+
+        void* init_buf {mem_buffer};
+        std::size_t space {buffer_size};
+        if(!std::align(chk_align, chk_size, init_buf, space))
+            throw std::logic_error("Buffer is too small to hold a single chunk");
+
+        buf_start = static_cast<std::byte*>(init_buf);
+        total_chunks = (space - chk_size) / chunk_stride + 1;
+        if(total_chunks > index_mask)
+            throw std::logic_error("Buffer holds more chunks than the pool can index");
+        buf_length = total_chunks * chunk_stride;
+
+        // The free list starts empty, chunks are carved lazily so construction does not touch the buffer
+        head.store(make_head(0, 0), std::memory_order_relaxed);
+        free_chunks.store(total_chunks, std::memory_order_relaxed);
+    }
+
+    // Pool cannot be copied or moved, threads hold on to its address
+    concurrent_pool_allocator(const concurrent_pool_allocator&) = delete;
+    concurrent_pool_allocator& operator= (const concurrent_pool_allocator&) = delete;
+
+    ~concurrent_pool_allocator(){
+        if(mapped_bytes)
+            munmap(mem_buffer, mapped_bytes);
+    }
+
+    /**
+     * @brief deallocate Takes chunk address as input and deallocates that chunk. Thread-safe.
+     * @param ptr Address of the chunk to deallocate
+     */
+    void deallocate(std::byte* ptr){
+        // A misaligned address on the lock-free list would corrupt it
+        if(!is_chunk(reinterpret_cast<chunk_type*>(ptr)))
+            throw std::logic_error("Invalid Address");
+        // Recorded before the chunk is pushed, another thread may pop it right after
+        trace_deallocation(ptr);
+        deallocate_chunk(ptr);
+        stats.record_deallocation(chunk_stride);
+    }
+
+    /**
+     * @brief allocate Allocates new chunk. Thread-safe.
+     * @return Address of allocated memory chunk or nullptr if the pool is exhausted
+     */
+    std::byte* allocate() noexcept(init != chunk_init::poison) {
+        std::byte* ptr {allocate_chunk()};
+        if(ptr)
+            stats.record_allocation(chk_size, chunk_stride);
+        else
+            stats.record_failure();
+        trace_allocation(ptr, chk_size, chk_align);
+        return ptr;
+    }
+
+    /**
+     * @brief allocate_n Allocates a batch of chunks. Thread-safe.
+     * A run of chunks is popped from the free list with a single compare-and-swap, the rest of the batch is
+     * carved from the unused part of the buffer with another one.
+     * @param chunks Receives the addresses of the allocated chunks
+     * @return Number of chunks allocated, less than chunks.size() if the pool is exhausted
+     */
+    std::size_t allocate_n(std::span<std::byte*> chunks) noexcept(init != chunk_init::poison) {
+        std::size_t count {0};
+        std::uint64_t old_head {head.load(std::memory_order_acquire)};
+        while(true){
+            count = 0;
+            chunk_type* node {chunk_at(old_head & index_mask)};
+            bool stale {false};
+            while(count < chunks.size() && node != nullptr){
+                chunks[count++] = reinterpret_cast<std::byte*>(node);
+                // Links of a run which changed under us can point anywhere, only follow links to chunks.
+                // The CAS below fails for a stale run.
+                node = std::atomic_ref<chunk_type*>(node->next).load(std::memory_order_relaxed);
+                if(node != nullptr && !is_chunk(node)){
+                    stale = true;
+                    break;
+                }
+            }
+            if(stale){
+                old_head = head.load(std::memory_order_acquire);
+                continue;
+            }
+            if(count == 0 || head.compare_exchange_weak(old_head, make_head(index_of(node), (old_head >> 32) + 1), std::memory_order_acquire, std::memory_order_acquire))
+                break;
+        }
+        const std::size_t recycled {count};
+
+        std::uint64_t index {carved_chunks.load(std::memory_order_relaxed)};
+        std::uint64_t carved {0};
+        do{
+            carved = std::min<std::uint64_t>(chunks.size() - count, total_chunks - std::min<std::uint64_t>(index, total_chunks));
+        }while(carved && !carved_chunks.compare_exchange_weak(index, index + carved, std::memory_order_relaxed));
+        for(std::uint64_t i = 0; i < carved; ++i){
+            chunks[count++] = reinterpret_cast<std::byte*>(chunk_at(index + i + 1));
+        }
+        free_chunks.fetch_sub(count, std::memory_order_relaxed);
+
+        for(std::size_t i = 0; i < count; ++i){
+            init_chunk<init>(chunks[i], chk_size, i < recycled, sizeof(chunk_type));
+            stats.record_allocation(chk_size, chunk_stride);
+            trace_allocation(chunks[i], chk_size, chk_align);
+        }
+        if(count < chunks.size())
+            stats.record_failure();
+        return count;
+    }
+
+    /**
+     * @brief deallocate_n Deallocates a batch of chunks. Thread-safe.
+     * The chunks are linked into a run which is pushed to the free list with a single compare-and-swap.
+     * No chunk is deallocated if any address is invalid.
+     * @param chunks Addresses of the chunks to deallocate
+     */
+    void deallocate_n(std::span<std::byte* const> chunks){
+        if(chunks.empty())
+            return;
+        for(std::byte* ptr : chunks){
+            if(!is_chunk(reinterpret_cast<chunk_type*>(ptr)))
+                throw std::logic_error("Invalid Address");
+        }
+        for(std::byte* ptr : chunks)
+            trace_deallocation(ptr);
+        for(std::size_t i = 0; i + 1 < chunks.size(); ++i){
+            release_chunk<init>(chunks[i] + sizeof(chunk_type), chk_size - sizeof(chunk_type));
+            std::atomic_ref<chunk_type*>(reinterpret_cast<chunk_type*>(chunks[i])->next).store(reinterpret_cast<chunk_type*>(chunks[i + 1]), std::memory_order_relaxed);
+            stats.record_deallocation(chunk_stride);
+        }
+        release_chunk<init>(chunks.back() + sizeof(chunk_type), chk_size - sizeof(chunk_type));
+        stats.record_deallocation(chunk_stride);
+
+        chunk_type* last {reinterpret_cast<chunk_type*>(chunks.back())};
+        const std::uint64_t index {index_of(reinterpret_cast<chunk_type*>(chunks.front()))};
+        std::uint64_t old_head {head.load(std::memory_order_relaxed)};
+        do{
+            std::atomic_ref<chunk_type*>(last->next).store(chunk_at(old_head & index_mask), std::memory_order_relaxed);
+        }while(!head.compare_exchange_weak(old_head, make_head(index, (old_head >> 32) + 1), std::memory_order_release, std::memory_order_relaxed));
+        free_chunks.fetch_add(chunks.size(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief available_chunks
+     * @return Total number of available chunks. The value is a snapshot and may be stale by the time
+     * it is returned if other threads are using the pool.
+     */
+    std::size_t available_chunks() const noexcept {
+        return free_chunks.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief allocated_chunks
+     * @return Total number of allocated chunks (snapshot).
+     */
+    std::size_t allocated_chunks() const noexcept {
+        return total_chunks - available_chunks();
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics, counters are updated with relaxed atomics
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        return stats.snapshot();
+    }
+#endif
+};
+
+
+#endif // CONCURRENT_POOL_ALLOCATOR_HPP
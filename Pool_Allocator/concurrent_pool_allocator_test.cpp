@@ -0,0 +1,75 @@
+#include "concurrent_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+template<typename F>
+static bool rejects(F&& deallocation){
+    try{
+        deallocation();
+    }
+    catch(const std::logic_error&){
+        return true;
+    }
+    return false;
+}
+
+int main(){
+
+    constexpr std::size_t thread_count {4};
+    constexpr std::size_t chunks_per_thread {1000};
+    constexpr std::size_t rounds {200};
+
+    concurrent_pool_allocator<16, 8> pool(16 * thread_count * chunks_per_thread);
+
+    CHECK(pool.allocated_chunks() == 0);
+    CHECK(pool.available_chunks() == thread_count * chunks_per_thread);
+
+    // Every thread repeatedly grabs a batch of chunks, tags them with its id and verifies that no other
+    // thread received the same chunk before giving them back.
+    std::vector<std::thread> threads;
+    std::vector<int> failures(thread_count, 0);
+    for(std::size_t t = 0; t < thread_count; ++t){
+        threads.emplace_back([&, t](){
+            std::vector<std::size_t*> chunks(chunks_per_thread);
+            for(std::size_t r = 0; r < rounds; ++r){
+                for(auto& chunk : chunks){
+                    chunk = reinterpret_cast<std::size_t*>(pool.allocate());
+                    if(!chunk){
+                        ++failures[t];
+                        return;
+                    }
+                    chunk[1] = t;
+                }
+                for(auto chunk : chunks){
+                    if(chunk[1] != t)
+                        ++failures[t];
+                    pool.deallocate(reinterpret_cast<std::byte*>(chunk));
+                }
+            }
+        });
+    }
+    std::for_each(threads.begin(), threads.end(), [](std::thread& th){ th.join(); });
+
+    std::printf("Allocated chunks: %zu, available chunks: %zu\n", pool.allocated_chunks(), pool.available_chunks());
+    CHECK(std::all_of(failures.begin(), failures.end(), [](int f){ return f == 0; }));
+    CHECK(pool.allocated_chunks() == 0);
+
+    {
+        // Addresses which are not the start of a chunk are rejected and the free list is left alone
+        std::byte* chunk {pool.allocate()};
+        std::byte outside[16];
+        CHECK(rejects([&]{ pool.deallocate(chunk + 8); }));
+        CHECK(rejects([&]{ pool.deallocate(outside); }));
+        std::byte* batch[] {chunk, chunk + 1};
+        CHECK(rejects([&]{ pool.deallocate_n(batch); }));
+        CHECK(pool.allocated_chunks() == 1);
+        pool.deallocate(chunk);
+        CHECK(pool.allocated_chunks() == 0);
+    }
+
+    return test::exit_code();
+}
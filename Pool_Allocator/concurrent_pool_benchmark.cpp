@@ -0,0 +1,86 @@
+#include "concurrent_pool_allocator.hpp"
+#include "pool_allocator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ *  Scalability benchmark for concurrent_pool_allocator. Every thread repeatedly allocates a burst of chunks
+ *  and frees them again. The same workload is run against a pool_allocator guarded by a std::mutex, which is
+ *  how the single-threaded pool has to be shared between threads. Usage:
+ *
+ *      concurrent_pool_benchmark [max_threads] [ops_per_thread]
+ */
+
+constexpr std::size_t chunk_bytes {64};
+constexpr std::size_t burst {32};
+
+template<typename Pool>
+struct mutex_pool{
+    Pool pool;
+    std::mutex mtx;
+
+    explicit mutex_pool(std::size_t bytes) : pool(bytes) {}
+
+    std::byte* allocate(){
+        std::lock_guard<std::mutex> lock{mtx};
+        return pool.allocate();
+    }
+
+    void deallocate(std::byte* ptr){
+        std::lock_guard<std::mutex> lock{mtx};
+        pool.deallocate(ptr);
+    }
+};
+
+template<typename Pool>
+double run(Pool& pool, std::size_t threads, std::size_t ops_per_thread){
+
+    std::vector<std::thread> workers;
+    const auto start {std::chrono::steady_clock::now()};
+    for(std::size_t t = 0; t < threads; ++t){
+        workers.emplace_back([&pool, ops_per_thread](){
+            std::byte* chunks[burst];
+            for(std::size_t op = 0; op < ops_per_thread; op += burst){
+                for(auto& chunk : chunks)
+                    chunk = pool.allocate();
+                for(auto chunk : chunks)
+                    pool.deallocate(chunk);
+            }
+        });
+    }
+    std::for_each(workers.begin(), workers.end(), [](std::thread& th){ th.join(); });
+    const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - start};
+
+    // One operation is an allocate / deallocate pair
+    return static_cast<double>(threads * ops_per_thread) / elapsed.count();
+}
+
+int main(int argc, char* argv[]){
+
+    const std::size_t max_threads {std::max<std::size_t>(1, argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency())};
+    const std::size_t ops_per_thread {argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2'000'000};
+    const std::size_t pool_bytes {chunk_bytes * burst * max_threads};
+
+    // Powers of two up to max_threads, then max_threads itself
+    std::vector<std::size_t> thread_counts;
+    for(std::size_t threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    std::printf("%-8s %-18s %-18s %-8s\n", "threads", "mutex_pool ops/s", "lockfree ops/s", "speedup");
+    for(std::size_t threads : thread_counts){
+
+        mutex_pool<pool_allocator<chunk_bytes, 8>> locked(pool_bytes);
+        concurrent_pool_allocator<chunk_bytes, 8> lockfree(pool_bytes);
+
+        const double locked_ops {run(locked, threads, ops_per_thread)};
+        const double lockfree_ops {run(lockfree, threads, ops_per_thread)};
+        std::printf("%-8zu %-18.0f %-18.0f %-8.2f\n", threads, locked_ops, lockfree_ops, lockfree_ops / locked_ops);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "benchmark_common.hpp"
+#include "pool_node_allocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+/*
+ *  Node container benchmark. std::map and std::unordered_map keyed by int are filled with random keys, then
+ *  every step erases a random key and inserts a new one, so every operation allocates or frees one node.
+ *  The containers use std::allocator and pool_node_allocator, whose pool is sized for the live nodes.
+ *  Results are printed as JSON lines with ns per insert or erase. Usage:
+ *
+ *      node_container_benchmark [--quick]
+ */
+
+constexpr std::size_t live_nodes {1 << 16};
+
+template<typename T>
+using pool_alloc = pool_node_allocator<T, live_nodes>;
+
+using std_map = std::map<int, int>;
+using pool_map = std::map<int, int, std::less<int>, pool_alloc<std::pair<const int, int>>>;
+using std_unordered = std::unordered_map<int, int>;
+using pool_unordered = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, pool_alloc<std::pair<const int, int>>>;
+
+template<typename Map>
+bench::result run_case(const char* allocator, const char* container, std::size_t steps){
+
+    std::mt19937 rng {2024};
+    std::vector<int> keys(live_nodes * 2);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    Map map;
+    for(std::size_t i = 0; i < live_nodes; ++i)
+        map.emplace(keys[i], static_cast<int>(i));
+
+    // keys[0, live_nodes) are in the map, the rest are not
+    const bench::timer time;
+    for(std::size_t step = 0; step < steps; ++step){
+        const std::size_t out {rng() % live_nodes};
+        const std::size_t in {live_nodes + rng() % live_nodes};
+        map.erase(keys[out]);
+        map.emplace(keys[in], static_cast<int>(step));
+        std::swap(keys[out], keys[in]);
+    }
+    bench::do_not_optimize(map.size());
+
+    return bench::result{"node_container", allocator, container, steps * 2, time.seconds()};
+}
+
+int main(int argc, char* argv[]){
+
+    const bool quick {argc > 1 && std::strcmp(argv[1], "--quick") == 0};
+    const std::size_t steps {quick ? std::size_t{1} << 14 : std::size_t{1} << 22};
+
+    bool ok {true};
+    ok &= bench::run_isolated([&]{ return run_case<std_map>("std::allocator", "map", steps); });
+    ok &= bench::run_isolated([&]{ return run_case<pool_map>("pool_node_allocator", "map", steps); });
+    ok &= bench::run_isolated([&]{ return run_case<std_unordered>("std::allocator", "unordered_map", steps); });
+    ok &= bench::run_isolated([&]{ return run_case<pool_unordered>("pool_node_allocator", "unordered_map", steps); });
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+#ifndef OWNER_POOL_ALLOCATOR_HPP
+#define OWNER_POOL_ALLOCATOR_HPP
+
+
+/*
+ *  Owner Pool Allocator is a pool_allocator which belongs to one thread. The owner thread allocates and
+ *  deallocates chunks without any synchronization, exactly like a pool_allocator. Any other thread can
+ *  deallocate chunks too: they are pushed onto a lock-free remote free list, which the owner drains in one
+ *  batch on its next allocation. This fits producer / consumer pipelines where chunks are allocated on one
+ *  thread and released on others.
+ */
+
+
+#include <atomic>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include "chunk_init.hpp"
+#include "mmap_backing.hpp"
+#include "pool_allocator.hpp"
+
+
+/**
+ * @brief The owner_pool_allocator class
+ * The remote free list is a multiple-producer single-consumer stack threaded through the chunks with the
+ * same mem_chunk link as the pool. Producers push with a compare-and-swap, the owner takes the whole list
+ * with a single exchange, so there is no ABA problem. The owner only reads the head of the remote list with
+ * a relaxed load while it is empty, so the common case stays on cache lines no other thread writes.
+ *
+ * Chunks freed remotely count as allocated until the owner drains them. allocate(), allocate_n() and
+ * drain_remote_frees() must only be called by the owner thread, which is the thread that constructed the
+ * pool unless another thread takes over with adopt().
+ */
+
+template<std::size_t chk_size = sizeof(mem_chunk), std::size_t chk_align = alignof(mem_chunk), chunk_init init = chunk_init::none>
+class owner_pool_allocator{
+
+    using pool_type = pool_allocator<chk_size, chk_align, free_order::lifo, init>;
+
+    pool_type pool;
+    std::thread::id owner {std::this_thread::get_id()};
+
+    // Written by the remote threads, keep it off the cache line of the owner's state
+    alignas(64) std::atomic<mem_chunk*> remote_head {nullptr};
+
+private:
+
+    /**
+     * @brief push_remote Pushes the chain [first, last] onto the remote free list
+     */
+    void push_remote(mem_chunk* first, mem_chunk* last) noexcept {
+        mem_chunk* head {remote_head.load(std::memory_order_relaxed)};
+        do{
+            last->next = head;
+        }
+        while(!remote_head.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+public:
+
+    /**
+     * @brief owner_pool_allocator Default constructor
+     * Manages the memory equivalent to system page size.
+     */
+    owner_pool_allocator() = default;
+
+    /**
+     * @brief owner_pool_allocator Converting constructor
+     * @param buffer_size Size of the memory buffer in bytes, mapped by the allocator
+     * @param backing Backing options of the mapping
+     */
+    explicit owner_pool_allocator(const std::size_t& buffer_size, const mmap_backing& backing = {}) :
+        pool(buffer_size, backing) {}
+
+    /**
+     * @brief owner_pool_allocator Converting constructor
+     * Manages the user-provided memory buffer.
+     * @param buffer Starting address of memory buffer.
+     * @param buffer_size Size of memory buffer in bytes.
+     */
+    owner_pool_allocator(void* buffer, const std::size_t& buffer_size) :
+        pool(buffer, buffer_size) {}
+
+    owner_pool_allocator(const owner_pool_allocator&) = delete;
+    owner_pool_allocator& operator= (const owner_pool_allocator&) = delete;
+
+    /**
+     * @brief adopt Makes the calling thread the owner of the pool
+     * The previous owner must not use the pool concurrently with the hand-over.
+     */
+    void adopt() noexcept {
+        owner = std::this_thread::get_id();
+    }
+
+    /**
+     * @brief is_owner
+     * @return true if the calling thread owns the pool
+     */
+    bool is_owner() const noexcept {
+        return std::this_thread::get_id() == owner;
+    }
+
+    /**
+     * @brief drain_remote_frees Returns every chunk freed by the other threads to the pool. Owner only.
+     * @return Number of chunks returned
+     */
+    std::size_t drain_remote_frees(){
+        mem_chunk* chunk {remote_head.exchange(nullptr, std::memory_order_acquire)};
+        std::size_t count {0};
+        while(chunk != nullptr){
+            mem_chunk* next {chunk->next};
+            pool.deallocate(reinterpret_cast<std::byte*>(chunk));
+            chunk = next;
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief allocate Allocates new chunk. Owner only.
+     * @return Address of allocated memory chunk or nullptr if the pool is exhausted
+     * Chunks freed remotely are drained first, they are recycled before untouched memory is carved.
+     */
+    std::byte* allocate() noexcept(init != chunk_init::poison) {
+        if(remote_head.load(std::memory_order_relaxed) != nullptr)
+            drain_remote_frees();
+        return pool.allocate();
+    }
+
+    /**
+     * @brief allocate_n Allocates a batch of chunks. Owner only.
+     * @param chunks Receives the addresses of the allocated chunks
+     * @return Number of chunks allocated
+     */
+    std::size_t allocate_n(std::span<std::byte*> chunks) noexcept(init != chunk_init::poison) {
+        if(remote_head.load(std::memory_order_relaxed) != nullptr)
+            drain_remote_frees();
+        return pool.allocate_n(chunks);
+    }
+
+    /**
+     * @brief deallocate Deallocates the chunk from any thread
+     * @param ptr Address of the chunk to deallocate
+     * The owner returns the chunk to the pool directly, other threads push it onto the remote free list.
+     */
+    void deallocate(std::byte* ptr){
+        if(is_owner()){
+            pool.deallocate(ptr);
+            return;
+        }
+        if(!pool.owns(ptr))
+            throw std::logic_error("Invalid Address");
+        mem_chunk* chunk {reinterpret_cast<mem_chunk*>(ptr)};
+        push_remote(chunk, chunk);
+    }
+
+    /**
+     * @brief deallocate_n Deallocates a batch of chunks from any thread
+     * @param chunks Addresses of the chunks to deallocate
+     * A remote thread links the batch into a chain and publishes it with a single compare-and-swap.
+     * If any address does not belong to the pool, no chunk is deallocated.
+     */
+    void deallocate_n(std::span<std::byte*> chunks){
+        if(is_owner()){
+            pool.deallocate_n(chunks);
+            return;
+        }
+        if(chunks.empty())
+            return;
+        for(std::byte* ptr : chunks){
+            if(!pool.owns(ptr))
+                throw std::logic_error("Invalid Address");
+        }
+        for(std::size_t i = 0; i + 1 < chunks.size(); ++i)
+            reinterpret_cast<mem_chunk*>(chunks[i])->next = reinterpret_cast<mem_chunk*>(chunks[i + 1]);
+        push_remote(reinterpret_cast<mem_chunk*>(chunks.front()), reinterpret_cast<mem_chunk*>(chunks.back()));
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to the memory managed by the pool
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        return pool.owns(ptr);
+    }
+
+    /**
+     * @brief available_chunks
+     * @return Number of chunks available to the owner, chunks waiting on the remote free list are not included
+     */
+    std::size_t available_chunks() const noexcept {
+        return pool.available_chunks();
+    }
+
+    /**
+     * @brief allocated_chunks
+     * @return Number of allocated chunks, including the ones waiting on the remote free list
+     */
+    std::size_t allocated_chunks() const noexcept {
+        return pool.allocated_chunks();
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics, remote frees are recorded when they are drained
+     * Owner only.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        return pool.get_stats();
+    }
+#endif
+};
+
+
+#endif // OWNER_POOL_ALLOCATOR_HPP
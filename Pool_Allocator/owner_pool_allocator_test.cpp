@@ -0,0 +1,130 @@
+#include "owner_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+int main(){
+
+    {
+        // The owner allocates and frees locally, other threads free remotely
+        owner_pool_allocator<64, 8> pool(64 * 16);
+        CHECK(pool.is_owner());
+        std::byte* local {pool.allocate()};
+        std::byte* remote {pool.allocate()};
+        pool.deallocate(local);
+        CHECK(pool.available_chunks() == 15);
+
+        std::thread([&]{
+            CHECK(!pool.is_owner());
+            pool.deallocate(remote);
+
+            std::byte outside[64];
+            bool thrown {false};
+            try{
+                pool.deallocate(outside);
+            }
+            catch(const std::logic_error&){
+                thrown = true;
+            }
+            CHECK(thrown);
+        }).join();
+
+        // The remote free is pending until the owner drains it
+        CHECK(pool.allocated_chunks() == 1);
+        CHECK(pool.drain_remote_frees() == 1);
+        CHECK(pool.allocated_chunks() == 0);
+        CHECK(pool.allocate() == remote);
+    }
+
+    {
+        // An I/O thread allocates chunks and hands them to workers which free them
+        constexpr std::size_t workers_count {3};
+        constexpr std::size_t total {200000};
+        owner_pool_allocator<64, 8> pool(64 * 256);
+
+        std::mutex mtx;
+        std::queue<std::byte*> queue;
+        std::atomic<bool> done {false};
+        std::atomic<std::size_t> freed {0};
+        std::atomic<int> corrupted {0};
+
+        std::vector<std::thread> workers;
+        for(std::size_t w = 0; w < workers_count; ++w){
+            workers.emplace_back([&]{
+                std::vector<std::byte*> batch;
+                for(;;){
+                    {
+                        std::lock_guard<std::mutex> lock{mtx};
+                        while(!queue.empty() && batch.size() < 8){
+                            batch.push_back(queue.front());
+                            queue.pop();
+                        }
+                    }
+                    if(batch.empty()){
+                        if(done)
+                            break;
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    for(std::byte* chunk : batch){
+                        std::size_t seq;
+                        std::memcpy(&seq, chunk + 8, sizeof(seq));
+                        for(std::size_t i = 16; i < 64; ++i){
+                            if(chunk[i] != static_cast<std::byte>(seq))
+                                ++corrupted;
+                        }
+                    }
+                    freed += batch.size();
+                    // Odd batches free one chunk alone, the rest as a chain
+                    if(batch.size() % 2){
+                        pool.deallocate(batch.back());
+                        batch.pop_back();
+                    }
+                    pool.deallocate_n(batch);
+                    batch.clear();
+                }
+            });
+        }
+
+        std::thread io([&]{
+            pool.adopt();
+            for(std::size_t seq = 0; seq < total;){
+                std::byte* chunk {pool.allocate()};
+                if(!chunk){
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::memcpy(chunk + 8, &seq, sizeof(seq));
+                std::memset(chunk + 16, static_cast<int>(seq & 0xFF), 48);
+                std::lock_guard<std::mutex> lock{mtx};
+                queue.push(chunk);
+                ++seq;
+            }
+            done = true;
+        });
+        io.join();
+        for(auto& worker : workers)
+            worker.join();
+
+        CHECK(corrupted == 0);
+        CHECK(freed == total);
+
+        // Everything comes back once the new owner drains the remote list
+        pool.adopt();
+        pool.drain_remote_frees();
+        CHECK(pool.allocated_chunks() == 0);
+        std::set<std::byte*> unique;
+        while(std::byte* chunk = pool.allocate())
+            unique.insert(chunk);
+        CHECK(unique.size() == 256);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,380 @@
+#ifndef PERSISTENT_POOL_ALLOCATOR_HPP
+#define PERSISTENT_POOL_ALLOCATOR_HPP
+
+
+/*
+ *  Persistent Pool Allocator is a pool whose memory is a file mapped with MAP_SHARED. The free list and the
+ *  counters are kept in a header at the start of the file and free chunks are linked by index, so a restarted
+ *  process reopens the pool at whatever address the file is mapped and finds every allocation where it was
+ *  left. Objects stored in the pool must refer to each other by chunk index, not by pointer.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "chunk_init.hpp"
+
+
+/**
+ * @brief The persistent_pool_header class
+ * Layout of the start of a pool file. Chunk indices are 64-bit, persistent_pool_no_chunk ends the free list
+ * and marks an unset root.
+ */
+struct persistent_pool_header{
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t clean;            // 1 once the pool was closed by its destructor, 0 while a process has it open
+    std::uint64_t chunk_size;
+    std::uint64_t chunk_stride;
+    std::uint64_t chunk_offset;     // Offset of the first chunk from the start of the file
+    std::uint64_t total_chunks;
+    std::uint64_t head;             // First chunk of the free list
+    std::uint64_t carve_next;       // First chunk which has never been handed out
+    std::uint64_t free_chunks;      // Recomputed when the pool is reopened after a crash
+    std::uint64_t root;             // Chunk registered with set_root()
+};
+
+constexpr std::uint64_t persistent_pool_magic {0x4c4f4f50'54534550}; // "PESTPOOL"
+constexpr std::uint32_t persistent_pool_version {1};
+constexpr std::uint64_t persistent_pool_no_chunk {~std::uint64_t{0}};
+
+
+/**
+ * @brief The persistent_pool_allocator class
+ * The pool maps the file at path, creating it with room for the requested number of chunks if it is empty.
+ * An existing file keeps its own number of chunks and must have been created with the same chunk size and
+ * alignment. The file is locked with flock while it is open, a second pool on the same file throws.
+ *
+ * Every update of the free list is a single store to the header which is ordered after the writes it depends
+ * on, so a process killed at any point leaves a well-formed free list in the page cache; at worst the chunk
+ * being allocated or deallocated is leaked. The header is marked unclean while the pool is open, reopening
+ * a pool which was not closed cleanly walks the free list, cuts it at the first link that is out of range or
+ * loops, and recomputes the counters. Surviving a power loss needs sync(), the destructor syncs the file.
+ */
+
+template<std::size_t chk_size, std::size_t chk_align = alignof(std::uint64_t), chunk_init init = chunk_init::none>
+class persistent_pool_allocator{
+
+    static_assert(chk_size >= sizeof(std::uint64_t), "Chunk must be able to hold the index of the next free chunk");
+    static_assert(chk_align && (chk_align & (chk_align - 1)) == 0, "Alignment must be a power of two");
+    static_assert(chk_align <= 4096, "Chunks are aligned within a page aligned mapping");
+
+    constexpr static std::size_t chunk_stride {(chk_size + chk_align - 1) / chk_align * chk_align};
+    constexpr static std::size_t header_align {std::max<std::size_t>(chk_align, 64)};
+    constexpr static std::size_t chunk_offset {(sizeof(persistent_pool_header) + header_align - 1) / header_align * header_align};
+
+    int fd {-1};
+    void* mapping {MAP_FAILED};
+    std::size_t mapped_bytes {0};
+    persistent_pool_header* header {nullptr};
+    std::byte* base {nullptr};
+    bool was_recovered {false};
+
+    [[no_unique_address]] allocator_stats stats;
+
+private:
+
+    static std::uint64_t read_link(const std::byte* chunk) noexcept {
+        std::uint64_t next;
+        std::memcpy(&next, chunk, sizeof(next));
+        return next;
+    }
+
+    static void write_link(std::byte* chunk, std::uint64_t next) noexcept {
+        std::memcpy(chunk, &next, sizeof(next));
+    }
+
+    /**
+     * @brief publish Stores a header field after every earlier write to the mapping
+     */
+    static void publish(std::uint64_t& field, std::uint64_t value) noexcept {
+        std::atomic_ref<std::uint64_t>(field).store(value, std::memory_order_release);
+    }
+
+    /**
+     * @brief format Writes the header of a new pool, the magic number goes last
+     */
+    void format(std::size_t chunks) noexcept {
+        header->version = persistent_pool_version;
+        header->clean = 0;
+        header->chunk_size = chk_size;
+        header->chunk_stride = chunk_stride;
+        header->chunk_offset = chunk_offset;
+        header->total_chunks = chunks;
+        header->head = persistent_pool_no_chunk;
+        header->carve_next = 0;
+        header->free_chunks = chunks;
+        header->root = persistent_pool_no_chunk;
+        publish(header->magic, persistent_pool_magic);
+    }
+
+    /**
+     * @brief validate Checks that the file holds a pool with the chunk layout of this type
+     */
+    void validate() const {
+        if(header->magic != persistent_pool_magic || header->version != persistent_pool_version)
+            throw std::runtime_error("Not a pool file");
+        if(header->chunk_size != chk_size || header->chunk_stride != chunk_stride || header->chunk_offset != chunk_offset)
+            throw std::runtime_error("Pool file does not match the chunk layout");
+        if(header->total_chunks > (mapped_bytes - chunk_offset) / chunk_stride || header->carve_next > header->total_chunks)
+            throw std::runtime_error("Corrupt pool file");
+    }
+
+    /**
+     * @brief recover Repairs the free list of a pool which was not closed cleanly
+     * Chunks taken off the list but never handed out, or freed but not yet linked, are lost.
+     */
+    void recover(){
+        std::vector<bool> listed(header->carve_next);
+        std::uint64_t count {0};
+        std::byte* prev {nullptr};
+        for(std::uint64_t index = header->head; index != persistent_pool_no_chunk;){
+            if(index >= header->carve_next || listed[index]){
+                if(prev)
+                    write_link(prev, persistent_pool_no_chunk);
+                else
+                    header->head = persistent_pool_no_chunk;
+                break;
+            }
+            listed[index] = true;
+            ++count;
+            prev = address_of(index);
+            index = read_link(prev);
+        }
+        if(header->root != persistent_pool_no_chunk && header->root >= header->carve_next)
+            header->root = persistent_pool_no_chunk;
+        header->free_chunks = count + header->total_chunks - header->carve_next;
+        was_recovered = true;
+    }
+
+    /**
+     * @brief close_file Unmaps the pool and releases the file
+     * @param clean Syncs the file and marks the pool as closed cleanly first
+     */
+    void close_file(bool clean) noexcept {
+        if(mapping != MAP_FAILED){
+            if(clean && header && header->magic == persistent_pool_magic){
+                msync(mapping, mapped_bytes, MS_SYNC);
+                header->clean = 1;
+                msync(mapping, chunk_offset, MS_SYNC);
+            }
+            munmap(mapping, mapped_bytes);
+            mapping = MAP_FAILED;
+        }
+        if(fd >= 0){
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+public:
+
+    /**
+     * @brief persistent_pool_allocator Converting constructor
+     * Opens the pool stored in the file, or creates it if the file does not exist or is empty.
+     * @param path Path of the pool file
+     * @param chunks Number of chunks of a new pool, ignored when the file already holds a pool
+     * @throws std::system_error if the file cannot be opened, resized or is open in another pool,
+     * std::runtime_error if it does not hold a pool of this chunk layout, std::bad_alloc if it cannot be mapped
+     */
+    persistent_pool_allocator(const char* path, std::size_t chunks){
+        try{
+            fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if(fd < 0)
+                throw std::system_error(errno, std::generic_category(), path);
+            if(flock(fd, LOCK_EX | LOCK_NB) != 0)
+                throw std::system_error(errno, std::generic_category(), "Pool file is in use");
+
+            struct stat status;
+            if(fstat(fd, &status) != 0)
+                throw std::system_error(errno, std::generic_category(), path);
+            mapped_bytes = static_cast<std::size_t>(status.st_size);
+            if(mapped_bytes == 0){
+                if(chunks == 0)
+                    throw std::logic_error("Pool must hold at least one chunk");
+                mapped_bytes = chunk_offset + chunks * chunk_stride;
+                if(ftruncate(fd, static_cast<off_t>(mapped_bytes)) != 0)
+                    throw std::system_error(errno, std::generic_category(), path);
+            }
+            if(mapped_bytes < chunk_offset + chunk_stride)
+                throw std::runtime_error("Not a pool file");
+
+            mapping = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(mapping == MAP_FAILED)
+                throw std::bad_alloc();
+            header = static_cast<persistent_pool_header*>(mapping);
+            base = static_cast<std::byte*>(mapping) + chunk_offset;
+
+            // A file whose creation was interrupted before the header was complete is formatted again
+            if(header->magic == 0){
+                format((mapped_bytes - chunk_offset) / chunk_stride);
+            }
+            else{
+                validate();
+                if(!header->clean)
+                    recover();
+                header->clean = 0;
+            }
+            msync(mapping, chunk_offset, MS_SYNC);
+        }
+        catch(...){
+            close_file(false);
+            throw;
+        }
+    }
+
+    // Pool owns the file mapping, it cannot be copied
+    persistent_pool_allocator(const persistent_pool_allocator&) = delete;
+    persistent_pool_allocator& operator= (const persistent_pool_allocator&) = delete;
+
+    /**
+     * @brief ~persistent_pool_allocator Syncs the file, marks the pool as closed cleanly and unmaps it
+     */
+    ~persistent_pool_allocator(){
+        close_file(true);
+    }
+
+    /**
+     * @brief allocate Allocates new chunk
+     * @return Address of allocated memory chunk or nullptr if the pool is exhausted
+     */
+    [[gnu::malloc]] [[nodiscard]]
+    std::byte* allocate() noexcept(init != chunk_init::poison) {
+        std::byte* chunk;
+        if(const std::uint64_t index {header->head}; index != persistent_pool_no_chunk){
+            chunk = address_of(index);
+            publish(header->head, read_link(chunk));
+            init_chunk<init>(chunk, chk_size, true, sizeof(std::uint64_t));
+        }
+        else if(header->carve_next != header->total_chunks){
+            chunk = address_of(header->carve_next);
+            publish(header->carve_next, header->carve_next + 1);
+            init_chunk<init>(chunk, chk_size, false, 0);
+        }
+        else{
+            stats.record_failure();
+            return nullptr;
+        }
+        --header->free_chunks;
+        stats.record_allocation(chk_size, chunk_stride);
+        trace_allocation(chunk, chk_size, chk_align);
+        return chunk;
+    }
+
+    /**
+     * @brief deallocate Takes chunk address as input and deallocates that chunk.
+     * @param ptr Address of the chunk to deallocate, it must be the start of a chunk handed out by the pool
+     */
+    [[gnu::nonnull]]
+    void deallocate(std::byte* ptr){
+        if(!owns(ptr) || static_cast<std::size_t>(ptr - base) % chunk_stride != 0)
+            throw std::logic_error("Invalid Address");
+        release_chunk<init>(ptr, chk_size);
+        write_link(ptr, header->head);
+        publish(header->head, index_of(ptr));
+        ++header->free_chunks;
+        stats.record_deallocation(chunk_stride);
+        trace_deallocation(ptr);
+    }
+
+    /**
+     * @brief address_of Address of the chunk with the index in the current mapping
+     */
+    std::byte* address_of(std::uint64_t index) const noexcept {
+        return base + index * chunk_stride;
+    }
+
+    /**
+     * @brief index_of Index of the chunk starting at the address, which stays valid across restarts
+     */
+    std::uint64_t index_of(const void* ptr) const noexcept {
+        return static_cast<std::uint64_t>(static_cast<const std::byte*>(ptr) - base) / chunk_stride;
+    }
+
+    /**
+     * @brief set_root Registers the chunk from which a restarted process finds its data
+     * @param chunk Chunk of the pool, or nullptr to clear the root
+     */
+    void set_root(const std::byte* chunk){
+        if(chunk && !owns(chunk))
+            throw std::logic_error("Invalid Address");
+        publish(header->root, chunk ? index_of(chunk) : persistent_pool_no_chunk);
+    }
+
+    /**
+     * @brief root
+     * @return Chunk registered with set_root(), nullptr if none
+     */
+    std::byte* root() const noexcept {
+        return header->root == persistent_pool_no_chunk ? nullptr : address_of(header->root);
+    }
+
+    /**
+     * @brief sync Writes the pool back to the file
+     * @return false if msync failed
+     */
+    bool sync() noexcept {
+        return msync(mapping, mapped_bytes, MS_SYNC) == 0;
+    }
+
+    /**
+     * @brief recovered
+     * @return true if the pool was not closed cleanly by the previous process and its free list was repaired
+     */
+    bool recovered() const noexcept {
+        return was_recovered;
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to the chunks of the pool
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        const std::byte* addr {static_cast<const std::byte*>(ptr)};
+        return addr >= base && addr < base + header->total_chunks * chunk_stride;
+    }
+
+    /**
+     * @brief available_chunks
+     * @return Total number of available chunks
+     */
+    std::size_t available_chunks() const noexcept {
+        return header->free_chunks;
+    }
+
+    /**
+     * @brief allocated_chunks
+     * @return Total number of allocated chunks, including those leaked by a crash
+     */
+    std::size_t allocated_chunks() const noexcept {
+        return header->total_chunks - header->free_chunks;
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics of this process
+     * Chunks are interchangeable, so the pool never reports fragmentation.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        return stats.snapshot();
+    }
+#endif
+};
+
+
+#endif // PERSISTENT_POOL_ALLOCATOR_HPP
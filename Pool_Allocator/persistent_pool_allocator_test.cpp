@@ -0,0 +1,158 @@
+#include "persistent_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <vector>
+#include <sys/wait.h>
+
+using pool_type = persistent_pool_allocator<32, 8>;
+
+// Written after the free list link by the process which allocated the chunk, cleared before it frees it
+constexpr std::uint64_t in_use_tag {0xA110CA7EDC0FFEE5};
+
+static void set_tag(std::byte* chunk, std::uint64_t tag){
+    std::memcpy(chunk + 8, &tag, sizeof(tag));
+}
+
+static std::uint64_t tag_of(const std::byte* chunk){
+    std::uint64_t tag;
+    std::memcpy(&tag, chunk + 8, sizeof(tag));
+    return tag;
+}
+
+/**
+ * @brief churn Allocates and frees tagged chunks at random until the process is killed
+ */
+[[noreturn]] static void churn(const char* path, int ready_fd, unsigned seed){
+    pool_type pool(path, 0);
+    const char ready {1};
+    if(write(ready_fd, &ready, 1) != 1)
+        std::_Exit(2);
+    std::mt19937 rng {seed};
+    std::vector<std::byte*> live;
+    for(;;){
+        if(!live.empty() && (rng() % 2 || pool.available_chunks() == 0)){
+            const std::size_t victim {rng() % live.size()};
+            set_tag(live[victim], 0);
+            pool.deallocate(live[victim]);
+            live[victim] = live.back();
+            live.pop_back();
+        }
+        else if(std::byte* chunk = pool.allocate()){
+            set_tag(chunk, in_use_tag);
+            live.push_back(chunk);
+        }
+    }
+}
+
+int main(){
+
+    char path[] {"/tmp/persistent_pool_testXXXXXX"};
+    const int temp {mkstemp(path)};
+    CHECK(temp >= 0);
+    close(temp);
+
+    {
+        // Allocations, the free list and the root survive closing and reopening the pool
+        std::vector<std::uint64_t> indices;
+        {
+            pool_type pool(path, 1000);
+            CHECK(!pool.recovered());
+            CHECK(pool.available_chunks() == 1000);
+            for(std::uint64_t i = 0; i < 100; ++i){
+                std::byte* chunk {pool.allocate()};
+                std::memcpy(chunk, &i, sizeof(i));
+                indices.push_back(pool.index_of(chunk));
+            }
+            pool.deallocate(pool.address_of(indices[10]));
+            pool.deallocate(pool.address_of(indices[20]));
+            pool.set_root(pool.address_of(indices[42]));
+        }
+        {
+            pool_type pool(path, 5);
+            CHECK(!pool.recovered());
+            CHECK(pool.available_chunks() == 902);
+            CHECK(pool.allocated_chunks() == 98);
+            CHECK(pool.root() == pool.address_of(indices[42]));
+            std::uint64_t value;
+            std::memcpy(&value, pool.address_of(indices[99]), sizeof(value));
+            CHECK(value == 99);
+
+            // The free list continues in LIFO order
+            CHECK(pool.index_of(pool.allocate()) == indices[20]);
+            CHECK(pool.index_of(pool.allocate()) == indices[10]);
+
+            // The file is locked while the pool is open
+            bool in_use {false};
+            try{
+                pool_type second(path, 0);
+            }
+            catch(const std::system_error&){
+                in_use = true;
+            }
+            CHECK(in_use);
+        }
+        {
+            // A pool type with another chunk layout rejects the file
+            bool rejected {false};
+            try{
+                persistent_pool_allocator<64, 8> other(path, 0);
+            }
+            catch(const std::runtime_error&){
+                rejected = true;
+            }
+            CHECK(rejected);
+        }
+    }
+
+    // Processes killed at random points in the middle of allocating and freeing
+    for(unsigned round = 0; round < 20; ++round){
+        CHECK(truncate(path, 0) == 0);
+        {
+            pool_type pool(path, 4096);
+        }
+
+        int ready[2];
+        CHECK(pipe(ready) == 0);
+        const pid_t child {fork()};
+        if(child == 0){
+            close(ready[0]);
+            churn(path, ready[1], round);
+        }
+        close(ready[1]);
+        char byte;
+        CHECK(read(ready[0], &byte, 1) == 1);
+        close(ready[0]);
+        usleep(200 + round * 150);
+        kill(child, SIGKILL);
+        int status {0};
+        waitpid(child, &status, 0);
+        CHECK(WIFSIGNALED(status));
+
+        pool_type pool(path, 0);
+        CHECK(pool.recovered());
+
+        // Every chunk on the free list or never handed out is free, none of them is still in use
+        const std::size_t available {pool.available_chunks()};
+        std::set<std::byte*> handed_out;
+        while(std::byte* chunk = pool.allocate()){
+            CHECK(tag_of(chunk) != in_use_tag);
+            handed_out.insert(chunk);
+        }
+        CHECK(handed_out.size() == available);
+        CHECK(pool.available_chunks() == 0);
+
+        // Chunks in use by the killed process are intact, at most one chunk in flight was lost
+        std::size_t in_use {0};
+        for(std::uint64_t i = 0; i < 4096; ++i)
+            in_use += tag_of(pool.address_of(i)) == in_use_tag && !handed_out.count(pool.address_of(i));
+        CHECK(in_use + available <= 4096 && in_use + available >= 4095);
+    }
+
+    unlink(path);
+    return test::exit_code();
+}
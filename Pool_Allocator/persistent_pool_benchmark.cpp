@@ -0,0 +1,107 @@
+#include "benchmark_common.hpp"
+#include "persistent_pool_allocator.hpp"
+#include "pool_allocator.hpp"
+#include <cstring>
+#include <string>
+
+/*
+ *  Startup time of a service holding its objects in a pool. A cold start rebuilds every object in an
+ *  anonymous pool_allocator, a warm start reopens a persistent_pool_allocator file which already holds them,
+ *  either cleanly closed or left behind by a killed process, in which case the free list is repaired first.
+ *  reopen_and_scan also reads every object, which faults in the pages of the file. Usage:
+ *
+ *      persistent_pool_benchmark [--quick] [pool_file]
+ */
+
+constexpr std::size_t object_size {64};
+
+using persistent_pool = persistent_pool_allocator<object_size, 8>;
+
+struct object{
+    std::uint64_t id;
+    std::uint64_t next;    // Index of the next object
+    std::byte payload[object_size - 2 * sizeof(std::uint64_t)];
+};
+
+static void build(object* obj, std::uint64_t id, std::uint64_t next){
+    obj->id = id;
+    obj->next = next;
+    std::memset(obj->payload, static_cast<int>(id), sizeof(obj->payload));
+}
+
+/**
+ * @brief create_file Fills a pool file with the objects, frees every other one if fragmented
+ * @param crash Leave the pool behind as a killed process would, without closing it
+ */
+static void create_file(const std::string& path, std::size_t objects, bool fragmented, bool crash){
+    unlink(path.c_str());
+    const pid_t pid {fork()};
+    if(pid == 0){
+        {
+            persistent_pool pool(path.c_str(), objects);
+            for(std::uint64_t i = 0; i < objects; ++i)
+                build(reinterpret_cast<object*>(pool.allocate()), i, i + 1);
+            pool.set_root(pool.address_of(0));
+            if(fragmented){
+                for(std::uint64_t i = 1; i < objects; i += 2)
+                    pool.deallocate(pool.address_of(i));
+            }
+            if(crash)
+                std::_Exit(0);
+        }
+        std::_Exit(0);
+    }
+    int status {0};
+    waitpid(pid, &status, 0);
+}
+
+static bench::result startup_result(const char* allocator, const char* pattern, std::size_t objects, double seconds){
+    char fields[64];
+    std::snprintf(fields, sizeof(fields), "\"startup_ms\":%.3f", seconds * 1e3);
+    return bench::result{"persistent_pool", allocator, pattern, objects, seconds, 0, true, fields};
+}
+
+int main(int argc, char* argv[]){
+
+    bool quick {false};
+    std::string path {"persistent_pool_benchmark.pool"};
+    for(int i = 1; i < argc; ++i){
+        if(std::strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else
+            path = argv[i];
+    }
+    const std::size_t objects {quick ? std::size_t{1} << 14 : std::size_t{1} << 23};
+
+    bool ok {true};
+    ok &= bench::run_isolated([&]{
+        const bench::timer time;
+        pool_allocator<object_size, 8> pool(objects * object_size);
+        for(std::uint64_t i = 0; i < objects; ++i)
+            build(reinterpret_cast<object*>(pool.allocate()), i, i + 1);
+        return startup_result("pool_allocator", "rebuild", objects, time.seconds());
+    });
+
+    for(const char* pattern : {"reopen", "reopen_and_scan", "recover_after_crash"}){
+        const bool scan {std::strcmp(pattern, "reopen_and_scan") == 0};
+        const bool crash {std::strcmp(pattern, "recover_after_crash") == 0};
+        create_file(path, objects, crash, crash);
+        ok &= bench::run_isolated([&]{
+            const bench::timer time;
+            persistent_pool pool(path.c_str(), 0);
+            const object* root {reinterpret_cast<const object*>(pool.root())};
+            std::uint64_t sum {root->id};
+            if(scan){
+                for(std::uint64_t i = 0; i < objects; ++i)
+                    sum += reinterpret_cast<const object*>(pool.address_of(i))->next;
+            }
+            bench::do_not_optimize(sum);
+            const double seconds {time.seconds()};
+            if(pool.recovered() != crash)
+                std::_Exit(1);
+            return startup_result("persistent_pool_allocator", pattern, objects, seconds);
+        });
+    }
+    unlink(path.c_str());
+    return ok ? 0 : 1;
+}
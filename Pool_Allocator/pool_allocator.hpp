@@ -8,13 +8,20 @@
  */
 
 
+#include <algorithm>
 #include <memory>
 #include <cstddef>
+#include <span>
 #include <sys/mman.h>
 #include <sys/resource.h>
 #include <unistd.h>
 #include <stdexcept>
 #include <cstring>
+#include <vector>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "chunk_init.hpp"
+#include "mmap_backing.hpp"
 
 /**
  * @brief The mem_chunk class
@@ -28,28 +35,74 @@ struct mem_chunk{
 };
 
 
+/**
+ * @brief The free_order enum
+ * Selects where a deallocated chunk is placed in the free list.
+ * lifo            - Chunk is pushed to the front of the list. Deallocation is O(1) and the most
+ *                   recently freed (cache-hot) chunk is handed out next. This is the default.
+ * address_ordered - Chunk is inserted in address order. Deallocation is O(n) in the number of
+ *                   free chunks, but allocations are served from the lowest addresses first which
+ *                   keeps the live set dense.
+ */
+
+enum class free_order{
+    lifo,
+    address_ordered
+};
+
+
 /**
  * @brief The pool_allocator class
  * Pool Allocator class manages the region of memory from which the allocator allocates and deallocates the
  * memory chunks. Pool Allocator imposes certain constraints on types for which pool allocator can be used.
  * The minimum size and minimum alignment to use pool allocator is the size and alignment of its internal chunk
  * type (mem_chunk). The Allocator maintains the linked list in the same memory region which is to be managed.
+ * The number of free and allocated chunks is tracked on every operation, so occupancy queries are O(1).
+ * The contents of allocated chunks are decided by the chunk_init policy, by default chunks are not initialized.
+ * A mapping created by the pool is unmapped when the pool is destroyed, trim() returns the pages holding only
+ * free chunks to the operating system while the pool is alive.
  */
 
-template<std::size_t chk_size = sizeof(mem_chunk), std::size_t chk_align = alignof(mem_chunk)>
+template<std::size_t chk_size = sizeof(mem_chunk), std::size_t chk_align = alignof(mem_chunk), free_order order = free_order::lifo,
+         chunk_init init = chunk_init::none>
 class pool_allocator{
 
 
     using chunk_type = mem_chunk;
+
+    /**
+     * @brief The chunk_run class
+     * Range of chunks which are free but not on the free list, they are carved like the unused part of the buffer.
+     */
+    struct chunk_run{
+        std::byte* begin;
+        std::byte* end;
+    };
+
+    // Runs of chunks whose pages were released by trim(), beyond the one being carved
+    constexpr static std::size_t max_released_runs {16};
+
     static_assert(chk_size >= sizeof(chunk_type), "Chunk size must be 8 bytes minimum");
     static_assert(chk_align >= alignof(chunk_type), "Chunk must atleast be 8-byte aligned");
 
     void* mem_buffer;
     std::size_t mem_buffer_size;
-    chunk_type* head;
+    std::size_t mapped_bytes {0}; // Length of the mapping owned by the pool, 0 for a user-provided buffer
+    chunk_type* head {nullptr};
+    std::byte* carve_next;          // Next chunk of the run being carved, initially the first chunk of the buffer
+    std::byte* carve_end;           // End of the run being carved, initially the end of the last chunk of the buffer
+    // Sorted by descending address, the lowest run is carved next
+    chunk_run released_runs[max_released_runs];
+    std::size_t released_count {0};
+    std::size_t total_chunks {0};
+    std::size_t free_chunks {0};
 
     const long page_size {sysconf(_SC_PAGE_SIZE)}; // Is system page size needed as a NSDM ?
     constexpr static std::size_t chunk_size = sizeof(chunk_type);
+    // Distance between two consecutive chunks in the buffer
+    constexpr static std::size_t chunk_stride = (chk_size + chk_align - 1) / chk_align * chk_align;
+
+    [[no_unique_address]] allocator_stats stats;
 
     void* buf_start;
     std::size_t buf_length;
@@ -57,22 +110,52 @@ class pool_allocator{
 private:
 
     /**
-     * @brief allocate_chunk Removes the chunk at the beginning of the list.
-     * @return Address of the removed chunk.
+     * @brief next_run Makes the lowest run released by trim() the run being carved
+     * @return false if there is no such run
+     */
+    bool next_run() noexcept {
+        if(released_count == 0)
+            return false;
+        const chunk_run& run {released_runs[--released_count]};
+        carve_next = run.begin;
+        carve_end = run.end;
+        return true;
+    }
+
+    /**
+     * @brief allocate_chunk Removes the chunk at the beginning of the list. When the list is empty the
+     * chunk is carved from the part of the buffer which has never been used.
+     * @return Address of the removed chunk or nullptr if the pool is exhausted.
      * This is an internal function of the Allocator. Users are supposed to use
      * allocate() member function to allocate chunk.
      */
-    [[gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
-    std::byte* allocate_chunk(){
-        chunk_type* node {head};
-        head = head->next;
-        return reinterpret_cast<std::byte*>(std::memset(node, '\0', chk_size));
+    [[gnu::malloc]] [[nodiscard]]
+    std::byte* allocate_chunk() noexcept(init != chunk_init::poison) {
+        std::byte* node;
+        if(head != nullptr){
+            node = reinterpret_cast<std::byte*>(head);
+            head = head->next;
+            --free_chunks;
+            init_chunk<init>(node, chk_size, true, sizeof(chunk_type));
+        }
+        else if(carve_next != carve_end || next_run()){
+            node = carve_next;
+            carve_next += chunk_stride;
+            --free_chunks;
+            init_chunk<init>(node, chk_size, false, 0);
+        }
+        else{
+            return nullptr;
+        }
+        return node;
     }
 
 
     /**
-     * @brief deallocate_chunk Inserts the new chunk at appropriate place in the list.
+     * @brief deallocate_chunk Returns the chunk to the free list.
      * @param ptr Starting address of the chunk to be deallocated
+     * The chunk is pushed to the front of the list unless the pool is configured with
+     * free_order::address_ordered, in which case it is inserted at its sorted position.
      * This is an internal function of the Allocator. Users are supposed to use
      * deallocate(std::byte*) member function to deallocate chunk.
      */
@@ -80,27 +163,36 @@ private:
     void deallocate_chunk(std::byte* ptr){
         if(!(ptr >= buf_start && ptr < (static_cast<std::byte*>(buf_start) + buf_length)))
             throw std::logic_error("Invalid Address");
+        release_chunk<init>(ptr, chk_size);
         chunk_type* chunk {reinterpret_cast<chunk_type*>(ptr)};
-        if(head > chunk){
-            chunk->next = head;
-            head = chunk;
-        }
-        else{
-            auto curr_node {head};
-            auto prev_node {head};
-            while(chunk > curr_node && curr_node != nullptr){
-                prev_node = curr_node;
-                curr_node = curr_node->next;
-            }
-            if(!prev_node){
+
+        if constexpr (order == free_order::address_ordered){
+            if(head == nullptr || chunk < head){
+                chunk->next = head;
                 head = chunk;
-                head->next = nullptr;
             }
             else{
+                chunk_type* prev_node {head};
+                while(prev_node->next != nullptr && prev_node->next < chunk){
+                    prev_node = prev_node->next;
+                }
+                chunk->next = prev_node->next;
                 prev_node->next = chunk;
-                chunk->next = curr_node;
             }
         }
+        else{
+            chunk->next = head;
+            head = chunk;
+        }
+        ++free_chunks;
+    }
+
+    /**
+     * @brief pool_allocator Takes ownership of a mapping created by map_backing
+     */
+    pool_allocator(const backing_region& region, const std::size_t& buffer_size) :
+        pool_allocator(region.address, buffer_size) {
+        mapped_bytes = region.bytes;
     }
 
 public:
@@ -116,14 +208,27 @@ public:
      * @brief pool_allocator Converting constructor
      * Manages the memory equivalent to user-provided buffer size.
      * @param buffer_size Size of the memory buffer in bytes. Allocator allocates
-     * the storage to manage memory of the required size.
+     * the storage to manage memory of the required size. The storage is released
+     * when the allocator is destroyed.
      */
     explicit pool_allocator(const std::size_t& buffer_size) :
-        pool_allocator(mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,  0), buffer_size) {}
+        pool_allocator(buffer_size, mmap_backing{}) {}
+
+    /**
+     * @brief pool_allocator Converting constructor
+     * Maps the memory with the requested page size, pre-faulting and NUMA placement.
+     * @param buffer_size Size of the memory buffer in bytes. The mapping may be rounded up to the huge
+     * page size, the pool only carves chunks out of the first buffer_size bytes.
+     * @param backing Backing options of the mapping
+     */
+    pool_allocator(const std::size_t& buffer_size, const mmap_backing& backing) :
+        pool_allocator(map_backing(buffer_size, backing), buffer_size) {}
 
     /**
      * @brief pool_allocator Converting constructor
-     * Manages the user-provided memory buffer.
+     * Manages the user-provided memory buffer. Construction is O(1) and does not touch the buffer, chunks
+     * are carved from the front of the buffer on first use and only recycled chunks are kept on the free
+     * list, so pages are committed as the pool grows into them.
      * @param buffer Starting address of memory buffer.
      * @param buffer_size Size of memory buffer in bytes.
      */
@@ -133,6 +238,9 @@ public:
         buf_start{mem_buffer},
         buf_length{mem_buffer_size} {
 
+        if(mem_buffer == MAP_FAILED || mem_buffer == nullptr)
+            throw std::bad_alloc();
+
         void* init_buf {mem_buffer};
         std::size_t space {buffer_size};
         buf_start = std::align(chk_align, chk_size, init_buf, space);
@@ -141,14 +249,19 @@ public:
         }
         buf_length = space;
 
-        chunk_type* curr_chunk {reinterpret_cast<chunk_type*>(buf_start)};
-        while(void* new_chk_start = std::align(chk_align, chk_size, init_buf, space)){
-            curr_chunk->next = reinterpret_cast<chunk_type*>(new_chk_start);
-            curr_chunk = curr_chunk->next;
-            init_buf = static_cast<std::byte*>(init_buf) + chk_size;
-            space -= chk_size;
-        }
-        head = reinterpret_cast<chunk_type*>(buf_start);
+        total_chunks = (space - chk_size) / chunk_stride + 1;
+        free_chunks = total_chunks;
+        carve_next = static_cast<std::byte*>(buf_start);
+        carve_end = carve_next + total_chunks * chunk_stride;
+    }
+
+    // Pool owns the mapping, it cannot be copied
+    pool_allocator(const pool_allocator&) = delete;
+    pool_allocator& operator= (const pool_allocator&) = delete;
+
+    ~pool_allocator(){
+        if(mapped_bytes)
+            munmap(mem_buffer, mapped_bytes);
     }
 
     /**
@@ -157,40 +270,232 @@ public:
      */
     void deallocate(std::byte* ptr){
         deallocate_chunk(ptr);
+        stats.record_deallocation(chunk_stride);
+        trace_deallocation(ptr);
     }
 
     /**
      * @brief allocate Allocates new chunk
-     * @return Address of allocated memory chunk
+     * @return Address of allocated memory chunk or nullptr if the pool is exhausted
      */
-    std::byte* allocate() noexcept {
-        return allocate_chunk();
+    std::byte* allocate() noexcept(init != chunk_init::poison) {
+        std::byte* ptr {allocate_chunk()};
+        if(ptr)
+            stats.record_allocation(chk_size, chunk_stride);
+        else
+            stats.record_failure();
+        trace_allocation(ptr, chk_size, chk_align);
+        return ptr;
     }
 
     /**
-     * @brief available_chunks
-     * @return Total number of available chunks
+     * @brief allocate_n Allocates a batch of chunks
+     * A run of chunks is popped from the free list in one pass, the rest of the batch is carved from the
+     * unused part of the buffer.
+     * @param chunks Receives the addresses of the allocated chunks
+     * @return Number of chunks allocated, less than chunks.size() if the pool is exhausted
      */
-    std::size_t available_chunks() const noexcept {
-        if(head == nullptr)
-            return 0;
+    std::size_t allocate_n(std::span<std::byte*> chunks) noexcept(init != chunk_init::poison) {
+        std::size_t count {0};
+        chunk_type* node {head};
+        while(count < chunks.size() && node != nullptr){
+            chunks[count++] = reinterpret_cast<std::byte*>(node);
+            node = node->next;
+        }
+        head = node;
+
+        const std::size_t recycled {count};
+        while(count < chunks.size() && (carve_next != carve_end || next_run())){
+            const std::size_t carved {std::min<std::size_t>(chunks.size() - count, (carve_end - carve_next) / chunk_stride)};
+            for(std::size_t i = 0; i < carved; ++i, carve_next += chunk_stride){
+                chunks[count++] = carve_next;
+            }
+        }
+        free_chunks -= count;
 
-        chunk_type* curr_chunk {head};
-        std::size_t count{0};
-        while(curr_chunk != nullptr){
-            ++count;
-            curr_chunk = curr_chunk->next;
+        for(std::size_t i = 0; i < count; ++i){
+            init_chunk<init>(chunks[i], chk_size, i < recycled, sizeof(chunk_type));
+            stats.record_allocation(chk_size, chunk_stride);
+            trace_allocation(chunks[i], chk_size, chk_align);
         }
+        if(count < chunks.size())
+            stats.record_failure();
         return count;
     }
 
+    /**
+     * @brief deallocate_n Deallocates a batch of chunks
+     * The chunks are linked into a run and spliced into the free list in one operation. Pools configured
+     * with free_order::address_ordered sort the batch in place and merge it into the free list in a single
+     * pass, instead of walking the list for every chunk. The pool is not modified if any address is invalid.
+     * @param chunks Addresses of the chunks to deallocate
+     */
+    void deallocate_n(std::span<std::byte*> chunks){
+        if(chunks.empty())
+            return;
+        for(std::byte* ptr : chunks){
+            if(!owns(ptr))
+                throw std::logic_error("Invalid Address");
+        }
+
+        if constexpr (order == free_order::address_ordered){
+            std::sort(chunks.begin(), chunks.end());
+            chunk_type** link {&head};
+            for(std::byte* ptr : chunks){
+                release_chunk<init>(ptr, chk_size);
+                chunk_type* chunk {reinterpret_cast<chunk_type*>(ptr)};
+                while(*link != nullptr && *link < chunk)
+                    link = &(*link)->next;
+                chunk->next = *link;
+                *link = chunk;
+                link = &chunk->next;
+            }
+        }
+        else{
+            // The run is linked back to front, so that the chunks are handed out again in the same order
+            chunk_type* run {head};
+            for(std::size_t i = chunks.size(); i-- > 0;){
+                release_chunk<init>(chunks[i], chk_size);
+                chunk_type* chunk {reinterpret_cast<chunk_type*>(chunks[i])};
+                chunk->next = run;
+                run = chunk;
+            }
+            head = run;
+        }
+        for(std::byte* ptr : chunks){
+            stats.record_deallocation(chunk_stride);
+            trace_deallocation(ptr);
+        }
+        free_chunks += chunks.size();
+    }
+
+    /**
+     * @brief trim Returns the pages which hold only free chunks to the operating system
+     * The chunks on those pages are taken off the free list and kept as runs which are carved again, like the
+     * unused part of the buffer, once the free list is empty, so the pages are only faulted back in when the
+     * pool needs them. The largest max_released_runs runs are kept, the free list is rebuilt in address order.
+     * Trimming walks every chunk of the pool and allocates a bitmap of two bits per chunk.
+     * @param advice How the pages are returned
+     * @return Number of resident bytes released
+     */
+    std::size_t trim(decommit_advice advice = decommit_advice::dont_need){
+        if(free_chunks == 0)
+            return 0;
+
+        std::byte* const first {static_cast<std::byte*>(buf_start)};
+        // The last chunk is not padded to the stride, pages past it do not belong to the pool
+        std::byte* const last_end {first + (total_chunks - 1) * chunk_stride + chk_size};
+        const auto index_of = [first](const void* chunk){
+            return static_cast<std::size_t>(static_cast<const std::byte*>(chunk) - first) / chunk_stride;
+        };
+
+        // Free chunks, those on the free list, and those which end up in a released run
+        std::vector<bool> free(total_chunks), listed(total_chunks), unlisted(total_chunks);
+        for(chunk_type* node = head; node != nullptr; node = node->next)
+            free[index_of(node)] = listed[index_of(node)] = true;
+        const auto mark_unlisted = [&](const chunk_run& run){
+            for(std::size_t i = index_of(run.begin); i < index_of(run.end); ++i)
+                free[i] = unlisted[i] = true;
+        };
+        mark_unlisted({carve_next, carve_end});
+        for(std::size_t r = 0; r < released_count; ++r)
+            mark_unlisted(released_runs[r]);
+
+        // Chunks overlapping a page covered by free chunks only are taken off the list
+        const std::uintptr_t page {static_cast<std::uintptr_t>(page_size)};
+        const std::uintptr_t area {reinterpret_cast<std::uintptr_t>(first)};
+        const std::uintptr_t area_end {reinterpret_cast<std::uintptr_t>(last_end)};
+        for(std::uintptr_t addr = (area + page - 1) & ~(page - 1); addr + page <= area_end; addr += page){
+            const std::size_t lo {(addr - area) / chunk_stride};
+            const std::size_t hi {(addr + page - area + chunk_stride - 1) / chunk_stride};
+            bool whole {true};
+            for(std::size_t i = lo; i < hi && whole; ++i)
+                whole = free[i];
+            for(std::size_t i = lo; whole && i < hi; ++i)
+                unlisted[i] = true;
+        }
+
+        std::vector<chunk_run> runs;
+        for(std::size_t i = 0; i < total_chunks;){
+            if(!unlisted[i]){
+                ++i;
+                continue;
+            }
+            const std::size_t begin {i};
+            while(i < total_chunks && unlisted[i])
+                ++i;
+            runs.push_back({first + begin * chunk_stride, first + i * chunk_stride});
+        }
+        if(runs.size() > max_released_runs){
+            std::nth_element(runs.begin(), runs.begin() + max_released_runs, runs.end(), [](const chunk_run& a, const chunk_run& b){
+                return a.end - a.begin > b.end - b.begin;
+            });
+            for(auto run = runs.begin() + max_released_runs; run != runs.end(); ++run){
+                for(std::size_t i = index_of(run->begin); i < index_of(run->end); ++i)
+                    unlisted[i] = false;
+            }
+            runs.resize(max_released_runs);
+        }
+        std::sort(runs.begin(), runs.end(), [](const chunk_run& a, const chunk_run& b){ return a.begin > b.begin; });
+
+        // Free chunks outside the runs are linked in address order, the ones which were never on the list are released first
+        head = nullptr;
+        for(std::size_t i = total_chunks; i-- > 0;){
+            if(!free[i] || unlisted[i])
+                continue;
+            std::byte* ptr {first + i * chunk_stride};
+            if(!listed[i])
+                release_chunk<init>(ptr, chk_size);
+            chunk_type* chunk {reinterpret_cast<chunk_type*>(ptr)};
+            chunk->next = head;
+            head = chunk;
+        }
+
+        std::size_t released {0};
+        for(const chunk_run& run : runs)
+            released += decommit(run.begin, std::min(run.end, last_end), advice);
+
+        carve_next = carve_end = first;
+        released_count = runs.size();
+        std::copy(runs.begin(), runs.end(), released_runs);
+        next_run();
+        return released;
+    }
+
+    /**
+     * @brief owns Checks whether the address belongs to the memory managed by the pool
+     * @param ptr Address to check
+     */
+    bool owns(const void* ptr) const noexcept {
+        const std::byte* addr {static_cast<const std::byte*>(ptr)};
+        return addr >= buf_start && addr < static_cast<const std::byte*>(buf_start) + buf_length;
+    }
+
+    /**
+     * @brief available_chunks
+     * @return Total number of available chunks
+     */
+    std::size_t available_chunks() const noexcept {
+        return free_chunks;
+    }
+
     /**
      * @brief allocated_chunks
      * @return Total number of allocated chunks
      */
     std::size_t allocated_chunks() const noexcept {
-        return mem_buffer_size / chk_size - available_chunks();
+        return total_chunks - free_chunks;
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics
+     * Chunks are interchangeable, so the pool never reports fragmentation.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        return stats.snapshot();
     }
+#endif
 };
 
 
@@ -0,0 +1,100 @@
+#include "pool_allocator.hpp"
+#include "concurrent_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+int main(){
+
+    {
+        pool_allocator<32, 8> pool(32 * 100);
+        std::byte* chunks[64];
+        CHECK(pool.allocate_n(chunks) == 64);
+        CHECK(std::set<std::byte*>(std::begin(chunks), std::end(chunks)).size() == 64);
+        CHECK(pool.allocated_chunks() == 64);
+
+        // A freed run is handed out again in the same order
+        pool.deallocate_n(std::span{chunks, 16});
+        std::byte* again[16];
+        CHECK(pool.allocate_n(again) == 16);
+        CHECK(std::equal(std::begin(again), std::end(again), chunks));
+
+        // The batch is cut short when the pool runs out
+        std::byte* rest[64];
+        CHECK(pool.allocate_n(rest) == 36);
+        CHECK(pool.available_chunks() == 0);
+
+        // An invalid address leaves the pool untouched
+        std::byte outside[32];
+        std::byte* bad[] {rest[0], outside, rest[1]};
+        std::memset(rest[1], 0x5A, 32);
+        bool thrown {false};
+        try{
+            pool.deallocate_n(bad);
+        }
+        catch(const std::logic_error&){
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(pool.available_chunks() == 0);
+        // Chunks after the invalid address are still the caller's
+        CHECK(std::all_of(rest[1], rest[1] + 32, [](std::byte b){ return b == std::byte{0x5A}; }));
+
+        pool.deallocate_n(chunks);
+        pool.deallocate_n(std::span{rest, 36});
+        CHECK(pool.allocated_chunks() == 0);
+    }
+
+    {
+        // Address-ordered pools merge the sorted batch into the free list
+        pool_allocator<32, 8, free_order::address_ordered> pool(32 * 64);
+        std::byte* chunks[64];
+        CHECK(pool.allocate_n(chunks) == 64);
+        std::vector<std::byte*> odd, even;
+        for(std::size_t i = 0; i < 64; ++i)
+            (i % 2 ? odd : even).push_back(chunks[i]);
+        std::reverse(odd.begin(), odd.end());
+        pool.deallocate_n(odd);
+        pool.deallocate_n(even);
+
+        std::byte* sorted[64];
+        CHECK(pool.allocate_n(sorted) == 64);
+        CHECK(std::is_sorted(std::begin(sorted), std::end(sorted)));
+        CHECK(std::equal(std::begin(sorted), std::end(sorted), chunks));
+    }
+
+    {
+        // Threads exchange batches through the lock-free pool, every chunk must stay unique
+        constexpr std::size_t threads {4};
+        constexpr std::size_t batch {48};
+        concurrent_pool_allocator<64, 8> pool(64 * threads * batch);
+        std::vector<std::thread> workers;
+        std::vector<std::vector<std::byte*>> held(threads, std::vector<std::byte*>(batch));
+        for(std::size_t t = 0; t < threads; ++t){
+            workers.emplace_back([&pool, &chunks = held[t]](){
+                for(std::size_t round = 0; round < 20000; ++round){
+                    const std::size_t count {pool.allocate_n(chunks)};
+                    for(std::size_t i = 0; i < count; ++i)
+                        *reinterpret_cast<std::size_t*>(chunks[i] + 8) = round;
+                    pool.deallocate_n(std::span{chunks.data(), count});
+                }
+                chunks.resize(pool.allocate_n(chunks));
+            });
+        }
+        for(auto& worker : workers)
+            worker.join();
+
+        std::set<std::byte*> unique;
+        for(const auto& chunks : held)
+            unique.insert(chunks.begin(), chunks.end());
+        CHECK(unique.size() == threads * batch);
+        CHECK(pool.available_chunks() == 0);
+    }
+
+    return test::exit_code();
+}
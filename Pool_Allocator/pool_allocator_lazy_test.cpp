@@ -0,0 +1,90 @@
+#include "pool_allocator.hpp"
+#include "concurrent_pool_allocator.hpp"
+#include "slab_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <sys/resource.h>
+
+static long rss_kb(){
+    long pages {0};
+    if(std::FILE* statm = std::fopen("/proc/self/statm", "r")){
+        if(std::fscanf(statm, "%*s %ld", &pages) != 1)
+            pages = 0;
+        std::fclose(statm);
+    }
+    return pages * sysconf(_SC_PAGE_SIZE) / 1024;
+}
+
+int main(){
+
+    constexpr std::size_t pool_bytes {std::size_t{1} << 30};
+
+    {
+        // Constructing a 1 GiB pool neither walks nor commits the buffer
+        const long rss_before {rss_kb()};
+        const auto start {std::chrono::steady_clock::now()};
+        pool_allocator<64, 64> pool(pool_bytes);
+        const std::chrono::duration<double, std::milli> elapsed {std::chrono::steady_clock::now() - start};
+        const long rss_growth {rss_kb() - rss_before};
+        std::printf("1 GiB pool constructed in %.3f ms, RSS grew by %ld kB\n", elapsed.count(), rss_growth);
+        CHECK(rss_growth < 1024);
+        CHECK(pool.available_chunks() == pool_bytes / 64);
+
+        // Fresh chunks are carved in address order, recycled chunks are reused first
+        std::byte* first {pool.allocate()};
+        std::byte* second {pool.allocate()};
+        CHECK(second == first + 64);
+        pool.deallocate(first);
+        CHECK(pool.allocate() == first);
+        CHECK(pool.allocate() == second + 64);
+        CHECK(pool.allocated_chunks() == 3);
+    }
+
+    {
+        // Exhaust a small pool through both the carve and the free list paths
+        pool_allocator<24, 8, free_order::address_ordered> pool(24 * 10);
+        std::set<std::byte*> chunks;
+        while(std::byte* chunk = pool.allocate())
+            chunks.insert(chunk);
+        CHECK(chunks.size() == 10);
+        for(std::byte* chunk : chunks)
+            pool.deallocate(chunk);
+        CHECK(pool.allocate() == *chunks.begin());
+    }
+
+    {
+        concurrent_pool_allocator<64, 64> pool(pool_bytes);
+        CHECK(pool.available_chunks() == pool_bytes / 64);
+        std::byte* first {pool.allocate()};
+        std::byte* second {pool.allocate()};
+        CHECK(second == first + 64);
+        pool.deallocate(first);
+        CHECK(pool.allocate() == first);
+        CHECK(pool.allocated_chunks() == 2);
+    }
+
+    {
+        concurrent_pool_allocator<32, 8> pool(32 * 4);
+        std::byte* chunks[5];
+        for(auto& chunk : chunks)
+            chunk = pool.allocate();
+        CHECK(chunks[3] != nullptr && chunks[4] == nullptr);
+        pool.deallocate(chunks[0]);
+        CHECK(pool.allocate() == chunks[0]);
+    }
+
+    {
+        slab_pool_allocator<64, 8, fixed_slab_growth<4096>> slabs{0};
+        std::set<std::byte*> chunks;
+        for(std::size_t i = 0; i < 1000; ++i)
+            chunks.insert(slabs.allocate());
+        CHECK(chunks.size() == 1000 && !chunks.count(nullptr));
+        for(std::byte* chunk : chunks)
+            slabs.deallocate(chunk);
+        CHECK(slabs.mapped_slabs() == 0);
+    }
+
+    return test::exit_code();
+}
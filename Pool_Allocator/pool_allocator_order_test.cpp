@@ -0,0 +1,97 @@
+#include "pool_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+
+template<typename Pool>
+static std::vector<std::byte*> drain(Pool& pool){
+    std::vector<std::byte*> chunks;
+    while(std::byte* chunk = pool.allocate())
+        chunks.push_back(chunk);
+    return chunks;
+}
+
+template<free_order order>
+static void check_counters(){
+    // The counters follow every allocation and deallocation
+    pool_allocator<32, 8, order> pool(32 * 64);
+    CHECK(pool.available_chunks() == 64);
+    CHECK(pool.allocated_chunks() == 0);
+
+    std::mt19937 rng {7};
+    std::vector<std::byte*> live;
+    for(int i = 0; i < 2000; ++i){
+        if(live.empty() || (live.size() < 64 && rng() % 100 < 55)){
+            live.push_back(pool.allocate());
+            CHECK(live.back() != nullptr);
+        }
+        else{
+            std::swap(live[rng() % live.size()], live.back());
+            pool.deallocate(live.back());
+            live.pop_back();
+        }
+        CHECK(pool.allocated_chunks() == live.size());
+        CHECK(pool.available_chunks() == 64 - live.size());
+    }
+    for(std::byte* chunk : live)
+        pool.deallocate(chunk);
+    CHECK(pool.allocated_chunks() == 0);
+    CHECK(pool.available_chunks() == 64);
+}
+
+int main(){
+
+    check_counters<free_order::lifo>();
+    check_counters<free_order::address_ordered>();
+
+    {
+        // The first chunk of a fresh pool once linked to itself, so the pool handed it out forever.
+        // Every chunk is handed out exactly once before the pool reports exhaustion.
+        pool_allocator<32, 8> pool(32 * 16);
+        std::vector<std::byte*> chunks {drain(pool)};
+        CHECK(chunks.size() == 16);
+        CHECK(std::set<std::byte*>(chunks.begin(), chunks.end()).size() == chunks.size());
+        CHECK(pool.allocate() == nullptr);
+
+        // The same holds once the chunks went through the free list
+        for(std::byte* chunk : chunks)
+            pool.deallocate(chunk);
+        std::vector<std::byte*> again {drain(pool)};
+        CHECK(again.size() == 16);
+        CHECK(std::set<std::byte*>(again.begin(), again.end()).size() == again.size());
+    }
+
+    {
+        // Address ordered pools hand out the lowest free address first, whatever order chunks were freed in
+        pool_allocator<32, 8, free_order::address_ordered> pool(32 * 32);
+        std::vector<std::byte*> chunks {drain(pool)};
+        CHECK(chunks.size() == 32);
+        std::vector<std::byte*> freed;
+        for(std::size_t i = 0; i < chunks.size(); i += 3)
+            freed.push_back(chunks[i]);
+        std::shuffle(freed.begin(), freed.end(), std::mt19937{11});
+        for(std::byte* chunk : freed)
+            pool.deallocate(chunk);
+
+        std::vector<std::byte*> reused {drain(pool)};
+        CHECK(reused.size() == freed.size());
+        CHECK(std::is_sorted(reused.begin(), reused.end()));
+        std::sort(freed.begin(), freed.end());
+        CHECK(reused == freed);
+    }
+
+    {
+        // The default order hands out the most recently freed chunk first
+        pool_allocator<32, 8> pool(32 * 8);
+        std::vector<std::byte*> chunks {drain(pool)};
+        pool.deallocate(chunks[2]);
+        pool.deallocate(chunks[5]);
+        CHECK(pool.allocate() == chunks[5]);
+        CHECK(pool.allocate() == chunks[2]);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,115 @@
+#include "background_trimmer.hpp"
+#include "pool_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <vector>
+
+template<typename Pool>
+static std::vector<std::byte*> drain(Pool& pool){
+    std::vector<std::byte*> chunks;
+    while(std::byte* chunk = pool.allocate())
+        chunks.push_back(chunk);
+    return chunks;
+}
+
+int main(){
+
+    const std::size_t page {static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+
+    {
+        // Pages of free chunks are released, the chunk left in use keeps its page and its contents
+        pool_allocator<64, 64> pool(256 * page);
+        std::vector<std::byte*> chunks {drain(pool)};
+        CHECK(chunks.size() == 256 * page / 64);
+        for(std::byte* chunk : chunks)
+            std::memset(chunk, 0x5A, 64);
+        std::byte* const kept {chunks[10 * page / 64 + 3]};
+        for(std::byte* chunk : chunks){
+            if(chunk != kept)
+                pool.deallocate(chunk);
+        }
+
+        CHECK(pool.trim() == 255 * page);
+        CHECK(test::resident_pages(chunks.front(), chunks.back() + 64) == 1);
+        CHECK(kept[63] == std::byte{0x5A});
+        CHECK(pool.available_chunks() == chunks.size() - 1);
+        CHECK(pool.trim() == 0);
+
+        // Released chunks are handed out again, the pages only come back as they are used
+        std::byte* first {pool.allocate()};
+        CHECK(first != kept);
+        CHECK(test::resident_pages(chunks.front(), chunks.back() + 64) <= 2);
+        pool.deallocate(first);
+        std::vector<std::byte*> reused {drain(pool)};
+        CHECK(reused.size() == chunks.size() - 1);
+        CHECK(std::set<std::byte*>(reused.begin(), reused.end()).size() == reused.size());
+        CHECK(std::find(reused.begin(), reused.end(), kept) == reused.end());
+        for(std::byte* chunk : reused)
+            pool.deallocate(chunk);
+        pool.deallocate(kept);
+    }
+
+    {
+        // Only the largest runs are kept off the free list, a pool fragmented page by page stays usable
+        pool_allocator<128, 8> pool(128 * page);
+        std::vector<std::byte*> chunks {drain(pool)};
+        for(std::byte* chunk : chunks)
+            std::memset(chunk, 1, 128);
+        const std::size_t per_page {page / 128};
+        for(std::size_t i = 0; i < chunks.size(); ++i){
+            if((i / per_page) % 2 == 0)
+                pool.deallocate(chunks[i]);
+        }
+        CHECK(pool.trim() == 16 * page);
+
+        std::vector<std::byte*> batch(chunks.size());
+        CHECK(pool.allocate_n(batch) == chunks.size() / 2);
+        std::set<std::byte*> unique(batch.begin(), batch.begin() + static_cast<std::ptrdiff_t>(chunks.size() / 2));
+        CHECK(unique.size() == chunks.size() / 2);
+        CHECK(pool.allocate() == nullptr);
+    }
+
+    {
+        // Chunks moved from a released run to the free list are poisoned, so reusing them is not a use after free
+        pool_allocator<64, 8, free_order::lifo, chunk_init::poison> pool(8 * page);
+        std::vector<std::byte*> chunks {drain(pool)};
+        for(std::size_t i = 0; i < chunks.size(); i += 2)
+            pool.deallocate(chunks[i]);
+        pool.trim();
+        bool thrown {false};
+        try{
+            CHECK(drain(pool).size() == chunks.size() / 2);
+        }
+        catch(const std::logic_error&){
+            thrown = true;
+        }
+        CHECK(!thrown);
+    }
+
+    {
+        // The background trimmer releases the pages of a burst under the lock of the pool
+        pool_allocator<256, 8> pool(64 * page);
+        std::mutex lock;
+        std::vector<std::byte*> chunks {drain(pool)};
+        for(std::byte* chunk : chunks)
+            std::memset(chunk, 2, 256);
+        for(std::byte* chunk : chunks)
+            pool.deallocate(chunk);
+        {
+            background_trimmer trimmer(std::chrono::milliseconds(1), [&]{
+                std::lock_guard guard {lock};
+                return pool.trim();
+            });
+            while(trimmer.trims() < 2)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            CHECK(trimmer.released_bytes() == 64 * page);
+        }
+        CHECK(test::resident_pages(chunks.front(), chunks.back() + 256) == 0);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,105 @@
+#include "benchmark_common.hpp"
+#include "pool_allocator.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ *  Compares the backing policies of pool_allocator on a TLB bound workload. Every chunk of a large pool is
+ *  allocated and the chunks are linked into a single cycle in random order, then the cycle is chased. Each
+ *  step is a dependent load from a random page, so the run time is dominated by TLB and cache misses.
+ *  Every case runs in its own process and reports the time to construct the pool (mapping, pre-faulting and
+ *  carving the free list), the chase throughput and the dTLB load misses of the chase when the perf counters
+ *  are accessible. Usage:
+ *
+ *      pool_backing_benchmark [--quick] [pool_mib] [numa_node]
+ */
+
+constexpr std::size_t chunk_bytes {64};
+
+struct backing_case{
+    const char* name;
+    mmap_backing backing;
+};
+
+bench::result chase(const backing_case& test, std::size_t pool_bytes, std::size_t steps){
+
+    bench::result res {"pool_backing", test.name, "random_chase", steps};
+
+    const bench::timer construct_time;
+    pool_allocator<chunk_bytes, chunk_bytes> pool(pool_bytes, test.backing);
+    const double construct_seconds {construct_time.seconds()};
+
+    std::vector<std::byte*> chunks;
+    chunks.reserve(pool.available_chunks());
+    while(std::byte* chunk = pool.allocate())
+        chunks.push_back(chunk);
+
+    std::shuffle(chunks.begin(), chunks.end(), std::mt19937_64{42});
+    for(std::size_t i = 0; i < chunks.size(); ++i){
+        std::byte* next {chunks[(i + 1) % chunks.size()]};
+        std::memcpy(chunks[i], &next, sizeof(next));
+    }
+
+    bench::perf_counter dtlb_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                    (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    std::byte* curr {chunks.front()};
+    const bench::timer chase_time;
+    dtlb_misses.start();
+    for(std::size_t i = 0; i < steps; ++i)
+        curr = *reinterpret_cast<std::byte**>(curr);
+    const long long misses {dtlb_misses.stop()};
+    res.seconds = chase_time.seconds();
+    bench::do_not_optimize(curr);
+
+    res.fields = "\"construct_seconds\":" + std::to_string(construct_seconds) +
+                 ",\"dtlb_load_misses\":" + (misses < 0 ? std::string{"null"} : std::to_string(misses));
+    return res;
+}
+
+int main(int argc, char* argv[]){
+
+    bool quick {false};
+    std::vector<const char*> args;
+    for(int i = 1; i < argc; ++i){
+        if(std::strcmp(argv[i], "--quick") == 0)
+            quick = true;
+        else
+            args.push_back(argv[i]);
+    }
+
+    const std::size_t pool_mib {args.size() > 0 ? std::strtoul(args[0], nullptr, 10) : (quick ? 32 : 1024)};
+    const int numa_node {args.size() > 1 ? std::atoi(args[1]) : 0};
+    const std::size_t pool_bytes {pool_mib << 20};
+    const std::size_t steps {quick ? std::size_t{1} << 20 : std::size_t{1} << 25};
+
+    const backing_case cases[] {
+        {"standard",                  {page_policy::standard, false, -1}},
+        {"standard_populate",         {page_policy::standard, true, -1}},
+        {"transparent_huge",          {page_policy::transparent_huge, false, -1}},
+        {"transparent_huge_populate", {page_policy::transparent_huge, true, -1}},
+        {"explicit_huge",             {page_policy::explicit_huge, true, -1}},
+        {"numa_bound_populate",       {page_policy::transparent_huge, true, numa_node}},
+    };
+
+    bool ok {true};
+    for(const backing_case& test : cases){
+        ok &= bench::run_isolated([&]{
+            try{
+                return chase(test, pool_bytes, steps);
+            }
+            catch(const std::bad_alloc&){
+                // Huge pages not reserved or NUMA binding not available on this machine
+                bench::result res {"pool_backing", test.name, "random_chase"};
+                res.supported = false;
+                return res;
+            }
+        });
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "benchmark_common.hpp"
+#include "concurrent_pool_allocator.hpp"
+#include "pool_allocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ *  Per-chunk cost of the batch APIs. Chunks are allocated and freed in bursts of increasing size, once with
+ *  a loop of allocate() / deallocate() calls and once with a single allocate_n() / deallocate_n() call per
+ *  burst. The pool is kept partially filled with chunks freed in random order, so the address-ordered pool
+ *  has a realistic free list to walk. Every case reports ns per chunk (one allocation plus one deallocation).
+ *  Usage:
+ *
+ *      pool_batch_benchmark [--quick]
+ */
+
+constexpr std::size_t chunk_bytes {64};
+constexpr std::size_t resident_chunks {4096};
+
+template<typename Pool>
+void fragment(Pool& pool){
+    std::vector<std::byte*> chunks(resident_chunks * 2);
+    for(auto& chunk : chunks)
+        chunk = pool.allocate();
+    std::shuffle(chunks.begin(), chunks.end(), std::mt19937_64{7});
+    for(std::size_t i = 0; i < resident_chunks; ++i)
+        pool.deallocate(chunks[i]);
+}
+
+template<typename Pool, bool batched>
+bench::result run_case(const char* name, std::size_t burst, std::size_t total_chunks){
+
+    Pool pool(chunk_bytes * (resident_chunks * 2 + burst));
+    fragment(pool);
+
+    std::vector<std::byte*> chunks(burst);
+    const std::size_t rounds {total_chunks / burst};
+    const bench::timer time;
+    for(std::size_t round = 0; round < rounds; ++round){
+        if constexpr (batched){
+            pool.allocate_n(chunks);
+            bench::do_not_optimize(chunks.data());
+            pool.deallocate_n(chunks);
+        }
+        else{
+            for(auto& chunk : chunks)
+                chunk = pool.allocate();
+            bench::do_not_optimize(chunks.data());
+            for(auto chunk : chunks)
+                pool.deallocate(chunk);
+        }
+    }
+
+    bench::result res {"pool_batch", name, std::string{batched ? "batch_" : "single_"} + std::to_string(burst), rounds * burst};
+    res.seconds = time.seconds();
+    return res;
+}
+
+template<typename Pool>
+bool run_pool(const char* name, std::size_t total_chunks){
+    bool ok {true};
+    for(std::size_t burst : {1, 8, 32, 64, 128, 256}){
+        ok &= bench::run_isolated([&]{ return run_case<Pool, false>(name, burst, total_chunks); });
+        ok &= bench::run_isolated([&]{ return run_case<Pool, true>(name, burst, total_chunks); });
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]){
+
+    const bool quick {argc > 1 && std::strcmp(argv[1], "--quick") == 0};
+    const std::size_t lifo_chunks {quick ? std::size_t{1} << 16 : std::size_t{1} << 24};
+    // Every address-ordered deallocation walks the free list, keep the run time comparable
+    const std::size_t ordered_chunks {quick ? std::size_t{1} << 10 : std::size_t{1} << 16};
+
+    bool ok {true};
+    ok &= run_pool<pool_allocator<chunk_bytes, 8>>("pool_allocator", lifo_chunks);
+    ok &= run_pool<pool_allocator<chunk_bytes, 8, free_order::address_ordered>>("pool_allocator_address_ordered", ordered_chunks);
+    ok &= run_pool<concurrent_pool_allocator<chunk_bytes, 8>>("concurrent_pool_allocator", lifo_chunks);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#ifndef POOL_NODE_ALLOCATOR_HPP
+#define POOL_NODE_ALLOCATOR_HPP
+
+
+/*
+ *  Pool Node Allocator is an STL-compatible allocator for node-based containers (std::list, std::map,
+ *  std::set, std::unordered_map, ...). Containers rebind the allocator to their node type and allocate one
+ *  node at a time, those single-object requests are served in O(1) by a pool_allocator sized for the node.
+ *  Every other request, e.g. the bucket array of an unordered container, goes to a fallback allocator.
+ */
+
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include "pool_allocator.hpp"
+
+
+/**
+ * @brief The pool_node_allocator class
+ * Every type the allocator is rebound to has one pool of `nodes` chunks of sizeof(T) and alignof(T), shared
+ * by all the allocators with the same template arguments, like the arena of stack_allocator. The pool is
+ * mapped on the first single-object allocation. When it is exhausted the nodes are allocated from the
+ * fallback, deallocate() tells the two apart by address. The pools are not synchronized, containers using
+ * the same node type must not be modified concurrently.
+ *
+ * The allocator stores a fallback allocator rebound to T. Allocators compare equal if their fallbacks do,
+ * and propagate with the container exactly like the fallback.
+ */
+
+template<typename T, std::size_t nodes = 4096, typename Fallback = std::allocator<T>>
+class pool_node_allocator{
+
+    using fallback_type = typename std::allocator_traits<Fallback>::template rebind_alloc<T>;
+    using fallback_traits = std::allocator_traits<fallback_type>;
+
+    constexpr static std::size_t node_size {sizeof(T) > sizeof(mem_chunk) ? sizeof(T) : sizeof(mem_chunk)};
+    constexpr static std::size_t node_align {alignof(T) > alignof(mem_chunk) ? alignof(T) : alignof(mem_chunk)};
+    constexpr static std::size_t node_stride {(node_size + node_align - 1) / node_align * node_align};
+
+    using pool_type = pool_allocator<node_size, node_align>;
+
+    [[no_unique_address]] fallback_type fallback;
+
+    template<typename U, std::size_t other_nodes, typename OtherFallback>
+    friend class pool_node_allocator;
+
+private:
+
+    /**
+     * @brief node_pool Pool of the nodes of type T, mapped on first use
+     */
+    static pool_type& node_pool(){
+        static pool_type pool(nodes * node_stride + node_align);
+        return pool;
+    }
+
+public:
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = typename fallback_traits::propagate_on_container_copy_assignment;
+    using propagate_on_container_move_assignment = typename fallback_traits::propagate_on_container_move_assignment;
+    using propagate_on_container_swap = typename fallback_traits::propagate_on_container_swap;
+    using is_always_equal = typename fallback_traits::is_always_equal;
+
+    template<typename U>
+    struct rebind{
+        using other = pool_node_allocator<U, nodes, typename std::allocator_traits<Fallback>::template rebind_alloc<U>>;
+    };
+
+    /**
+     * @brief pool_node_allocator Default constructor
+     */
+    pool_node_allocator() = default;
+
+    /**
+     * @brief pool_node_allocator Converting constructor
+     * @param _fallback Allocator serving the requests the pool does not serve
+     */
+    explicit pool_node_allocator(const fallback_type& _fallback) noexcept : fallback(_fallback) {}
+
+    /**
+     * @brief pool_node_allocator Rebinding constructor, the fallback is rebound as well
+     */
+    template<typename U, typename OtherFallback>
+    pool_node_allocator(const pool_node_allocator<U, nodes, OtherFallback>& other) noexcept : fallback(other.fallback) {}
+
+    pool_node_allocator(const pool_node_allocator&) = default;
+    pool_node_allocator& operator=(const pool_node_allocator&) = default;
+
+    /**
+     * @brief allocate Allocates the memory
+     * @param count Total number of the objects of type T for which memory has to be allocated
+     * @return Address of the allocated memory
+     * A single object is taken from the pool, arrays and nodes beyond the pool capacity from the fallback.
+     */
+    [[nodiscard]]
+    T* allocate(std::size_t count){
+        if(count == 1){
+            if(std::byte* ptr {node_pool().allocate()}; ptr)
+                return reinterpret_cast<T*>(ptr);
+        }
+        return fallback_traits::allocate(fallback, count);
+    }
+
+    /**
+     * @brief deallocate Deallocates the memory
+     * @param ptr Ptr to an address of the object for which memory has to be deallocated
+     * @param count Total number of objects to deallocate, as passed to allocate()
+     */
+    void deallocate(T* ptr, std::size_t count){
+        if(count == 1 && node_pool().owns(ptr))
+            node_pool().deallocate(reinterpret_cast<std::byte*>(ptr));
+        else
+            fallback_traits::deallocate(fallback, ptr, count);
+    }
+
+    /**
+     * @brief pooled_objects
+     * @return Number of objects of type T currently allocated from the pool
+     */
+    static std::size_t pooled_objects(){
+        return node_pool().allocated_chunks();
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Statistics of the pool of type T, requests served by the fallback are not included
+     */
+    static allocator_stats_snapshot get_stats() noexcept {
+        return node_pool().get_stats();
+    }
+#endif
+
+    /**
+     * @brief select_on_container_copy_construction The copy of a container gets the allocator the
+     * fallback selects
+     */
+    pool_node_allocator select_on_container_copy_construction() const {
+        return pool_node_allocator(fallback_traits::select_on_container_copy_construction(fallback));
+    }
+
+    template<typename U, typename OtherFallback>
+    bool operator== (const pool_node_allocator<U, nodes, OtherFallback>& other) const noexcept {
+        return fallback == other.fallback;
+    }
+
+    template<typename U, typename OtherFallback>
+    bool operator!= (const pool_node_allocator<U, nodes, OtherFallback>& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+
+#endif // POOL_NODE_ALLOCATOR_HPP
@@ -0,0 +1,106 @@
+#include "pool_node_allocator.hpp"
+#include "test_common.hpp"
+#include <cstdio>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+static std::size_t fallback_live {0};
+static std::size_t fallback_calls {0};
+
+/**
+ * @brief The counting_allocator class
+ * Fallback which counts the requests the pools pass on to it.
+ */
+template<typename T>
+struct counting_allocator{
+    using value_type = T;
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t count){
+        ++fallback_calls;
+        ++fallback_live;
+        return std::allocator<T>{}.allocate(count);
+    }
+
+    void deallocate(T* ptr, std::size_t count){
+        --fallback_live;
+        std::allocator<T>{}.deallocate(ptr, count);
+    }
+
+    template<typename U>
+    bool operator== (const counting_allocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+template<typename T, std::size_t nodes = 4096>
+using node_allocator = pool_node_allocator<T, nodes, counting_allocator<T>>;
+
+int main(){
+
+    {
+        // Every node of a list comes from the pool
+        std::list<int, node_allocator<int>> lst;
+        for(int i = 0; i < 1000; ++i)
+            lst.push_back(i);
+        lst.remove_if([](int value){ return value % 3 == 0; });
+        CHECK(fallback_calls == 0);
+        CHECK(lst.size() == 666 && lst.front() == 1 && lst.back() == 998);
+    }
+    CHECK(fallback_live == 0);
+
+    {
+        // Nodes beyond the pool capacity overflow to the fallback and are returned to it
+        std::map<int, std::string, std::less<int>, node_allocator<std::pair<const int, std::string>, 64>> map;
+        for(int i = 0; i < 200; ++i)
+            map.emplace(i, std::to_string(i));
+        CHECK(fallback_live == 200 - 64);
+        for(int i = 0; i < 200; i += 2)
+            map.erase(i);
+        CHECK(map.size() == 100 && map.at(51) == "51");
+
+        // Freed pool nodes are reused before the fallback is asked again
+        const std::size_t calls {fallback_calls};
+        for(int i = 1000; i < 1000 + 32; ++i)
+            map.emplace(i, "x");
+        CHECK(fallback_calls == calls);
+    }
+    CHECK(fallback_live == 0);
+
+    {
+        // The bucket array of an unordered map goes to the fallback, its nodes to the pool
+        using map_type = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, node_allocator<std::pair<const int, int>>>;
+        fallback_calls = 0;
+        map_type map;
+        for(int i = 0; i < 1000; ++i)
+            map[i] = i * i;
+        const std::size_t bucket_allocations {fallback_calls};
+        CHECK(bucket_allocations > 0 && bucket_allocations < 20);
+        map_type copy {map};
+        CHECK(copy.size() == 1000 && copy.at(30) == 900);
+        copy.clear();
+        map.swap(copy);
+        CHECK(map.empty() && copy.size() == 1000);
+    }
+    CHECK(fallback_live == 0);
+
+    {
+        // Allocators of different node types compare equal when their fallbacks do
+        node_allocator<int> ints;
+        node_allocator<double> doubles {ints};
+        CHECK(ints == doubles);
+        int* single {ints.allocate(1)};
+        CHECK(node_allocator<int>::pooled_objects() == 1);
+        ints.deallocate(single, 1);
+        CHECK(node_allocator<int>::pooled_objects() == 0);
+    }
+
+    return test::exit_code();
+}
@@ -0,0 +1,386 @@
+#ifndef SLAB_POOL_ALLOCATOR_HPP
+#define SLAB_POOL_ALLOCATOR_HPP
+
+
+/*
+ *  Slab Pool Allocator is a growable variant of pool_allocator. Instead of managing one fixed region it
+ *  maps memory in slabs on demand. Each slab is an independent pool of chunks with its own free list. The
+ *  size of every new slab is decided by a growth policy and slabs whose chunks are all free are given back
+ *  to the operating system.
+ */
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "chunk_init.hpp"
+#include "mmap_backing.hpp"
+#include "pool_allocator.hpp"
+
+
+/**
+ * @brief The fixed_slab_growth class
+ * Growth policy which maps every slab with the same size.
+ */
+
+template<std::size_t slab_bytes>
+struct fixed_slab_growth{
+    static_assert((slab_bytes & (slab_bytes - 1)) == 0, "Slab size must be a power of two");
+
+    constexpr static std::size_t max_slab_bytes {slab_bytes};
+
+    constexpr static std::size_t slab_size([[maybe_unused]] std::size_t slab_count) noexcept {
+        return slab_bytes;
+    }
+};
+
+
+/**
+ * @brief The geometric_slab_growth class
+ * Growth policy which doubles the size of every new slab, starting from initial_bytes,
+ * until it reaches max_bytes.
+ */
+
+template<std::size_t initial_bytes, std::size_t max_bytes>
+struct geometric_slab_growth{
+    static_assert((initial_bytes & (initial_bytes - 1)) == 0, "Initial slab size must be a power of two");
+    static_assert((max_bytes & (max_bytes - 1)) == 0, "Maximum slab size must be a power of two");
+    static_assert(initial_bytes <= max_bytes, "Initial slab size cannot exceed the maximum slab size");
+
+    constexpr static std::size_t max_slab_bytes {max_bytes};
+
+    constexpr static std::size_t slab_size(std::size_t slab_count) noexcept {
+        std::size_t size {initial_bytes};
+        while(slab_count-- > 0 && size < max_bytes)
+            size *= 2;
+        return size;
+    }
+};
+
+
+/**
+ * @brief The slab_pool_allocator class
+ * Every slab starts at an address aligned to growth_policy::max_slab_bytes and begins with a slab_header.
+ * The owning slab of any chunk is found by masking the low bits of its address. Deallocation checks that slab
+ * against a sorted array of the mapped slabs before reading its header, so it stays O(log n) in the number of
+ * slabs and a foreign address is rejected instead of being dereferenced.
+ *
+ * Slabs with at least one free chunk are kept on the partial list, allocation always takes a chunk from the
+ * front of that list. Slabs which become empty are moved to the back so that chunks are preferably served
+ * from partially used slabs and empty slabs get a chance to be released. Up to retained_empty_slabs empty
+ * slabs are kept mapped to avoid repeated mmap / munmap calls when the pool oscillates around a slab boundary.
+ */
+
+template<std::size_t chk_size = sizeof(mem_chunk), std::size_t chk_align = alignof(mem_chunk),
+         typename growth_policy = geometric_slab_growth<(1 << 16), (1 << 20)>, chunk_init init = chunk_init::none>
+class slab_pool_allocator{
+
+
+    using chunk_type = mem_chunk;
+    static_assert(chk_size >= sizeof(chunk_type), "Chunk size must be 8 bytes minimum");
+    static_assert(chk_align >= alignof(chunk_type), "Chunk must atleast be 8-byte aligned");
+
+    struct slab_header{
+        chunk_type* head;
+        std::byte* carve_next;
+        std::byte* carve_end;
+        std::size_t free_chunks;
+        std::size_t total_chunks;
+        std::size_t slab_bytes;
+        slab_header* prev;
+        slab_header* next;
+    };
+
+    constexpr static std::size_t slab_align {growth_policy::max_slab_bytes};
+    constexpr static std::size_t chunk_stride {(chk_size + chk_align - 1) / chk_align * chk_align};
+    static_assert(sizeof(slab_header) + chk_align + chk_size <= slab_align, "Slab cannot hold a single chunk");
+
+    /**
+     * @brief The slab_list class
+     * Intrusive doubly linked list of slabs.
+     */
+    struct slab_list{
+        slab_header* first {nullptr};
+        slab_header* last {nullptr};
+
+        void push_front(slab_header* slab) noexcept {
+            slab->prev = nullptr;
+            slab->next = first;
+            (first ? first->prev : last) = slab;
+            first = slab;
+        }
+
+        void push_back(slab_header* slab) noexcept {
+            slab->next = nullptr;
+            slab->prev = last;
+            (last ? last->next : first) = slab;
+            last = slab;
+        }
+
+        void remove(slab_header* slab) noexcept {
+            (slab->prev ? slab->prev->next : first) = slab->next;
+            (slab->next ? slab->next->prev : last) = slab->prev;
+        }
+    };
+
+    slab_list partial_slabs;
+    slab_list full_slabs;
+    // Every mapped slab sorted by address, deallocate() checks a chunk's slab against it before reading the header
+    std::vector<slab_header*> slabs;
+
+    std::size_t slab_count {0};
+    std::size_t empty_slabs {0};
+    std::size_t retained_empty_slabs;
+
+    std::size_t total_chunks {0};
+    std::size_t free_chunks {0};
+
+    mmap_backing backing;
+
+    [[no_unique_address]] allocator_stats stats;
+
+private:
+
+    /**
+     * @brief map_slab Maps a new slab aligned to slab_align, its chunks are carved lazily.
+     * @return Header of the new slab or nullptr if the memory could not be mapped.
+     */
+    slab_header* map_slab() noexcept {
+
+        const std::size_t bytes {growth_policy::slab_size(slab_count)};
+
+        // Slabs smaller than a huge page cannot come from the huge page pool, advise them instead
+        mmap_backing slab_backing {backing};
+        if(slab_backing.pages == page_policy::explicit_huge && bytes % huge_page_size() != 0)
+            slab_backing.pages = page_policy::transparent_huge;
+
+        const backing_region region {map_backing(bytes, slab_backing, slab_align)};
+        if(region.address == MAP_FAILED)
+            return nullptr;
+
+        const std::uintptr_t slab_addr {reinterpret_cast<std::uintptr_t>(region.address)};
+        slab_header* slab {reinterpret_cast<slab_header*>(slab_addr)};
+        try{
+            slabs.insert(std::upper_bound(slabs.begin(), slabs.end(), slab), slab);
+        }
+        catch(const std::bad_alloc&){
+            munmap(region.address, region.bytes);
+            return nullptr;
+        }
+        slab->slab_bytes = region.bytes;
+
+        // Chunks are carved from the slab on first use, the free list only holds recycled chunks
+        void* init_buf {reinterpret_cast<std::byte*>(slab_addr) + sizeof(slab_header)};
+        std::size_t space {region.bytes - sizeof(slab_header)};
+        std::align(chk_align, chk_size, init_buf, space);
+        const std::size_t count {(space - chk_size) / chunk_stride + 1};
+
+        slab->head = nullptr;
+        slab->carve_next = static_cast<std::byte*>(init_buf);
+        slab->carve_end = slab->carve_next + count * chunk_stride;
+        slab->total_chunks = count;
+        slab->free_chunks = count;
+
+        ++slab_count;
+        total_chunks += count;
+        free_chunks += count;
+        return slab;
+    }
+
+    /**
+     * @brief unmap_slab Gives the slab back to the operating system.
+     */
+    void unmap_slab(slab_header* slab) noexcept {
+        --slab_count;
+        total_chunks -= slab->total_chunks;
+        free_chunks -= slab->free_chunks;
+        slabs.erase(std::lower_bound(slabs.begin(), slabs.end(), slab));
+        munmap(slab, slab->slab_bytes);
+    }
+
+    static slab_header* slab_of(const std::byte* ptr) noexcept {
+        return reinterpret_cast<slab_header*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(slab_align - 1));
+    }
+
+    /**
+     * @brief is_mapped Checks whether the slab is one of the slabs of the pool, without reading its header
+     */
+    bool is_mapped(const slab_header* slab) const noexcept {
+        const auto it {std::lower_bound(slabs.begin(), slabs.end(), slab)};
+        return it != slabs.end() && *it == slab;
+    }
+
+    /**
+     * @brief allocate_chunk Removes a chunk from the first partial slab, mapping a new slab if needed.
+     * @return Address of the removed chunk or nullptr if no memory is available.
+     */
+    [[gnu::malloc]] [[nodiscard]]
+    std::byte* allocate_chunk() noexcept(init != chunk_init::poison) {
+
+        slab_header* slab {partial_slabs.first};
+        if(slab == nullptr){
+            slab = map_slab();
+            if(slab == nullptr)
+                return nullptr;
+            partial_slabs.push_front(slab);
+        }
+        else if(slab->free_chunks == slab->total_chunks){
+            --empty_slabs;
+        }
+
+        std::byte* node;
+        const bool recycled {slab->head != nullptr};
+        if(recycled){
+            node = reinterpret_cast<std::byte*>(slab->head);
+            slab->head = slab->head->next;
+        }
+        else{
+            node = slab->carve_next;
+            slab->carve_next += chunk_stride;
+        }
+        --slab->free_chunks;
+        --free_chunks;
+
+        if(slab->free_chunks == 0){
+            partial_slabs.remove(slab);
+            full_slabs.push_front(slab);
+        }
+        init_chunk<init>(node, chk_size, recycled, sizeof(chunk_type));
+        return node;
+    }
+
+    /**
+     * @brief deallocate_chunk Pushes the chunk to the free list of its slab.
+     * @param ptr Starting address of the chunk to be deallocated
+     */
+    [[gnu::nonnull]]
+    void deallocate_chunk(std::byte* ptr){
+
+        slab_header* slab {slab_of(ptr)};
+        if(!is_mapped(slab) || ptr < reinterpret_cast<std::byte*>(slab + 1) || ptr >= reinterpret_cast<std::byte*>(slab) + slab->slab_bytes)
+            throw std::logic_error("Invalid Address");
+
+        release_chunk<init>(ptr, chk_size);
+        chunk_type* chunk {reinterpret_cast<chunk_type*>(ptr)};
+        chunk->next = slab->head;
+        slab->head = chunk;
+        ++slab->free_chunks;
+        ++free_chunks;
+
+        if(slab->free_chunks == 1){
+            full_slabs.remove(slab);
+            partial_slabs.push_front(slab);
+        }
+
+        if(slab->free_chunks == slab->total_chunks){
+            partial_slabs.remove(slab);
+            if(empty_slabs < retained_empty_slabs){
+                partial_slabs.push_back(slab);
+                ++empty_slabs;
+            }
+            else{
+                unmap_slab(slab);
+            }
+        }
+    }
+
+public:
+
+    /**
+     * @brief slab_pool_allocator Constructor
+     * No memory is mapped until the first allocation.
+     * @param retained_empty_slabs Number of completely free slabs which are kept mapped for reuse.
+     * @param backing Backing options used to map every slab. Explicit huge pages are only used for slabs
+     * whose size is a multiple of the huge page size, smaller slabs fall back to transparent huge pages.
+     */
+    explicit slab_pool_allocator(std::size_t retained_empty_slabs = 1, const mmap_backing& backing = {}) :
+        retained_empty_slabs{retained_empty_slabs},
+        backing{backing} {}
+
+    // Slabs refer back to the pool, it cannot be copied or moved
+    slab_pool_allocator(const slab_pool_allocator&) = delete;
+    slab_pool_allocator& operator= (const slab_pool_allocator&) = delete;
+
+    ~slab_pool_allocator(){
+        for(slab_list* list : {&partial_slabs, &full_slabs}){
+            while(slab_header* slab = list->first){
+                list->remove(slab);
+                unmap_slab(slab);
+            }
+        }
+    }
+
+    /**
+     * @brief deallocate Takes chunk address as input and deallocates that chunk.
+     * @param ptr Address of the chunk to deallocate
+     */
+    void deallocate(std::byte* ptr){
+        deallocate_chunk(ptr);
+        stats.record_deallocation(chunk_stride);
+        trace_deallocation(ptr);
+    }
+
+    /**
+     * @brief allocate Allocates new chunk
+     * @return Address of allocated memory chunk or nullptr if a new slab could not be mapped
+     */
+    std::byte* allocate() noexcept(init != chunk_init::poison) {
+        std::byte* ptr {allocate_chunk()};
+        if(ptr)
+            stats.record_allocation(chk_size, chunk_stride);
+        else
+            stats.record_failure();
+        trace_allocation(ptr, chk_size, chk_align);
+        return ptr;
+    }
+
+    /**
+     * @brief available_chunks
+     * @return Total number of available chunks in all mapped slabs
+     */
+    std::size_t available_chunks() const noexcept {
+        return free_chunks;
+    }
+
+    /**
+     * @brief allocated_chunks
+     * @return Total number of allocated chunks
+     */
+    std::size_t allocated_chunks() const noexcept {
+        return total_chunks - free_chunks;
+    }
+
+    /**
+     * @brief mapped_slabs
+     * @return Number of slabs currently mapped
+     */
+    std::size_t mapped_slabs() const noexcept {
+        return slab_count;
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics
+     * Fragmentation is the share of free chunks stranded in partially used slabs, which cannot be
+     * given back to the operating system.
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        std::size_t releasable {0};
+        for(slab_header* slab {partial_slabs.last}; slab && slab->free_chunks == slab->total_chunks; slab = slab->prev){
+            releasable += slab->free_chunks;
+        }
+        return stats.snapshot(fragmentation_ratio(releasable, free_chunks));
+    }
+#endif
+};
+
+
+#endif // SLAB_POOL_ALLOCATOR_HPP
@@ -0,0 +1,105 @@
+#include "slab_pool_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#define PRINT(fmt, str) std::printf(fmt, str);
+#define PRINTSTR(str) std::printf(str);
+
+#define PRINT_ALLOCATED_CHUNKS(obj) PRINT("Allocated chunks: %lu\n", obj.allocated_chunks());
+#define PRINT_AVAILABLE_CHUNKS(obj) PRINT("Available chunks: %lu\n", obj.available_chunks());
+#define PRINT_MAPPED_SLABS(obj) PRINT("Mapped slabs: %lu\n", obj.mapped_slabs());
+
+
+struct student{
+    long contact;
+    int age;
+    char* name;
+};
+
+using student_record_t =  student*;
+
+int main(){
+
+    constexpr auto req_size  {sizeof(student)};
+    constexpr auto req_align {alignof(student)};
+    constexpr std::size_t records {20000};
+
+    slab_pool_allocator<req_size, req_align, geometric_slab_growth<4096, 65536>> stud_alloc;
+    std::vector<student_record_t> ptrs(records);
+
+    PRINTSTR("===============Before allocations==================\n");
+    PRINT_ALLOCATED_CHUNKS(stud_alloc);
+    PRINT_AVAILABLE_CHUNKS(stud_alloc);
+    PRINT_MAPPED_SLABS(stud_alloc);
+
+    std::for_each(ptrs.begin(), ptrs.end(), [&](auto& elem){
+        elem = reinterpret_cast<student_record_t>(stud_alloc.allocate());
+        elem->age = 20;
+    });
+
+    PRINTSTR("===============After allocating all records==================\n");
+    PRINT_ALLOCATED_CHUNKS(stud_alloc);
+    PRINT_AVAILABLE_CHUNKS(stud_alloc);
+    PRINT_MAPPED_SLABS(stud_alloc);
+
+    const std::size_t peak_slabs {stud_alloc.mapped_slabs()};
+
+    std::for_each(ptrs.begin(), std::next(ptrs.begin(), records / 2), [&](auto elem){
+        stud_alloc.deallocate(reinterpret_cast<std::byte*>(elem));
+    });
+
+    PRINTSTR("===============After deallocating half of the records==================\n");
+    PRINT_ALLOCATED_CHUNKS(stud_alloc);
+    PRINT_AVAILABLE_CHUNKS(stud_alloc);
+    PRINT_MAPPED_SLABS(stud_alloc);
+
+    std::for_each(std::next(ptrs.begin(), records / 2), ptrs.end(), [&](auto elem){
+        stud_alloc.deallocate(reinterpret_cast<std::byte*>(elem));
+    });
+
+    PRINTSTR("===============After deallocating all records==================\n");
+    PRINT_ALLOCATED_CHUNKS(stud_alloc);
+    PRINT_AVAILABLE_CHUNKS(stud_alloc);
+    PRINT_MAPPED_SLABS(stud_alloc);
+
+    // Only the retained empty slab must still be mapped
+    CHECK(stud_alloc.allocated_chunks() == 0);
+    CHECK(stud_alloc.mapped_slabs() == 1);
+    CHECK(peak_slabs > 1);
+
+    {
+        // Addresses which do not belong to the pool are rejected before any slab header is read
+        slab_pool_allocator<req_size, req_align, geometric_slab_growth<4096, 65536>> other;
+        std::byte* foreign_chunk {other.allocate()};
+        std::byte on_stack[64];
+        static std::byte in_data[64];
+
+        // An address whose masked slab header would lie in an unmapped page
+        constexpr std::size_t slab_align {65536};
+        const std::size_t page {static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+        void* mapping {mmap(nullptr, 2 * slab_align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        CHECK(mapping != MAP_FAILED);
+        std::byte* aligned {reinterpret_cast<std::byte*>((reinterpret_cast<std::uintptr_t>(mapping) + slab_align - 1) & ~(slab_align - 1))};
+        munmap(aligned, page);
+
+        const std::size_t available {stud_alloc.available_chunks()};
+        for(std::byte* foreign : {foreign_chunk, on_stack, in_data, aligned + page}){
+            bool rejected {false};
+            try{
+                stud_alloc.deallocate(foreign);
+            }
+            catch(const std::logic_error&){
+                rejected = true;
+            }
+            CHECK(rejected);
+        }
+        CHECK(stud_alloc.available_chunks() == available);
+        other.deallocate(foreign_chunk);
+        munmap(mapping, 2 * slab_align);
+    }
+
+    return test::exit_code();
+}
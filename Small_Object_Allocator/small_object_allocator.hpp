@@ -0,0 +1,293 @@
+#ifndef SMALL_OBJECT_ALLOCATOR_HPP
+#define SMALL_OBJECT_ALLOCATOR_HPP
+
+
+/*
+ *  Small Object Allocator serves requests of arbitrary size by rounding them up to one of a fixed set of
+ *  compile-time size classes. Every size class is backed by its own slab_pool_allocator. Requests larger
+ *  than the largest size class, or with an alignment the size classes cannot satisfy, are mapped directly
+ *  with mmap.
+ */
+
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "allocation_trace.hpp"
+#include "allocator_stats.hpp"
+#include "slab_pool_allocator.hpp"
+
+
+namespace small_object_detail{
+
+    /**
+     * Size classes in bytes. Classes are spaced 8 bytes apart up to 64 bytes and by a quarter of the
+     * power of two below them afterwards, which keeps internal fragmentation under 25%.
+     */
+    constexpr std::array<std::size_t, 20> size_classes {
+        8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+    };
+
+    constexpr std::size_t max_small_size {size_classes.back()};
+    constexpr std::size_t granularity {8};
+
+    /**
+     * @brief class_alignment Alignment of chunks in a size class. It is the largest power of two which divides
+     * the class size, capped at the alignment of std::max_align_t, so that chunks are laid out without padding.
+     */
+    constexpr std::size_t class_alignment(std::size_t size) noexcept {
+        std::size_t align {size & (~size + 1)};
+        return align < alignof(std::max_align_t) ? align : alignof(std::max_align_t);
+    }
+
+    /**
+     * @brief class_index_table Maps (size + 7) / 8 to the index of the smallest size class which can hold size
+     * bytes, so that the size class of a request is found with a single table lookup.
+     */
+    constexpr auto class_index_table {[](){
+        std::array<std::uint8_t, max_small_size / granularity + 1> table{};
+        std::size_t cls {0};
+        for(std::size_t slot = 0; slot < table.size(); ++slot){
+            while(size_classes[cls] < slot * granularity)
+                ++cls;
+            table[slot] = static_cast<std::uint8_t>(cls);
+        }
+        return table;
+    }()};
+
+    template<std::size_t... I>
+    auto make_pools(std::index_sequence<I...>) -> std::tuple<slab_pool_allocator<size_classes[I], class_alignment(size_classes[I])>...>;
+
+    using pool_tuple = decltype(make_pools(std::make_index_sequence<size_classes.size()>{}));
+}
+
+
+/**
+ * @brief The small_object_allocator class
+ * Thread-unsafe segregated fit allocator. Deallocation requires the size (and alignment) which was used for
+ * allocation, the allocator does not store any per-block metadata.
+ */
+
+class small_object_allocator{
+
+    using pool_tuple = small_object_detail::pool_tuple;
+    constexpr static std::size_t class_count {small_object_detail::size_classes.size()};
+
+    pool_tuple pools;
+    const std::size_t page_size {static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+
+    [[no_unique_address]] allocator_stats stats;
+
+private:
+
+    /**
+     * @brief size_class Finds the size class for the request.
+     * @return Index of the size class or class_count if the request has to be served by mmap.
+     */
+    static std::size_t size_class(std::size_t count, std::size_t align) noexcept {
+        if(count > small_object_detail::max_small_size || align > alignof(std::max_align_t))
+            return class_count;
+
+        std::size_t cls {small_object_detail::class_index_table[(count + small_object_detail::granularity - 1) / small_object_detail::granularity]};
+
+        // Classes such as 24 or 40 are only 8-byte aligned, move up to the first class with enough alignment
+        while(cls < class_count && small_object_detail::class_alignment(small_object_detail::size_classes[cls]) < align)
+            ++cls;
+        return cls;
+    }
+
+    // The size class pools are not traced themselves, the request is recorded with its own size instead
+
+    template<std::size_t... I>
+    std::byte* allocate_from(std::size_t cls, std::index_sequence<I...>) noexcept {
+        const trace_suppression nested;
+        std::byte* ptr {nullptr};
+        static_cast<void>(((I == cls ? (ptr = std::get<I>(pools).allocate(), true) : false) || ...));
+        return ptr;
+    }
+
+    template<std::size_t... I>
+    void deallocate_to(std::size_t cls, std::byte* ptr, std::index_sequence<I...>){
+        const trace_suppression nested;
+        static_cast<void>(((I == cls ? (std::get<I>(pools).deallocate(ptr), true) : false) || ...));
+    }
+
+    std::size_t large_size(std::size_t count) const noexcept {
+        return (count + page_size - 1) / page_size * page_size;
+    }
+
+    /**
+     * @brief map_large Maps a block of large_size(count) bytes. mmap only aligns to the page size, for larger
+     * alignments align extra bytes are mapped and the pages around the aligned block are unmapped again.
+     * @return Address of the block or MAP_FAILED
+     */
+    void* map_large(std::size_t count, std::size_t align) const noexcept {
+        const std::size_t bytes {large_size(count)};
+        const std::size_t extra {align > page_size ? align : 0};
+        if(bytes + extra < bytes)
+            return MAP_FAILED;
+        void* ptr {mmap(nullptr, bytes + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if(ptr == MAP_FAILED || extra == 0)
+            return ptr;
+
+        std::byte* begin {static_cast<std::byte*>(ptr)};
+        std::byte* aligned {reinterpret_cast<std::byte*>((reinterpret_cast<std::uintptr_t>(begin) + align - 1) & ~(align - 1))};
+        if(aligned != begin)
+            munmap(begin, static_cast<std::size_t>(aligned - begin));
+        if(std::byte* end {begin + bytes + extra}; aligned + bytes != end)
+            munmap(aligned + bytes, static_cast<std::size_t>(end - aligned - bytes));
+        return aligned;
+    }
+
+public:
+
+    small_object_allocator() = default;
+
+    // Pools are not copyable
+    small_object_allocator(const small_object_allocator&) = delete;
+    small_object_allocator& operator= (const small_object_allocator&) = delete;
+
+    /**
+     * @brief allocate Allocates the storage
+     * @param count Size of block to allocate
+     * @param align Alignment of the block to allocate
+     * @return Address of the allocated block
+     */
+    [[gnu::malloc, gnu::returns_nonnull]] [[nodiscard]]
+    std::byte* allocate(std::size_t count, std::size_t align = alignof(std::max_align_t)){
+
+        if(const std::size_t cls {size_class(count, align)}; cls < class_count){
+            if(std::byte* ptr {allocate_from(cls, std::make_index_sequence<class_count>{})}; ptr){
+                stats.record_allocation(count, small_object_detail::size_classes[cls]);
+                trace_allocation(ptr, count, align);
+                return ptr;
+            }
+            stats.record_failure();
+            throw std::bad_alloc();
+        }
+
+        void* ptr {map_large(count, align)};
+        if(ptr == MAP_FAILED){
+            stats.record_failure();
+            throw std::bad_alloc();
+        }
+        stats.record_allocation(count, large_size(count));
+        trace_allocation(ptr, count, align);
+        return static_cast<std::byte*>(ptr);
+    }
+
+    /**
+     * @brief usable_size Number of bytes reserved for a request
+     * @param count Size of the block
+     * @param align Alignment of the block
+     * @return Size of the size class serving the request, or its page-rounded size if it is mapped with mmap
+     */
+    std::size_t usable_size(std::size_t count, std::size_t align = alignof(std::max_align_t)) const noexcept {
+        if(const std::size_t cls {size_class(count, align)}; cls < class_count)
+            return small_object_detail::size_classes[cls];
+        return large_size(count);
+    }
+
+    /**
+     * @brief deallocate Deallocates the storage
+     * @param ptr Address of the block to deallocate
+     * @param count Size of the block which was passed to allocate
+     * @param align Alignment of the block which was passed to allocate
+     */
+    void deallocate(std::byte* ptr, std::size_t count, std::size_t align = alignof(std::max_align_t)){
+        if(!ptr)
+            return;
+
+        trace_deallocation(ptr);
+        if(const std::size_t cls {size_class(count, align)}; cls < class_count){
+            deallocate_to(cls, ptr, std::make_index_sequence<class_count>{});
+            stats.record_deallocation(small_object_detail::size_classes[cls]);
+        }
+        else{
+            munmap(ptr, large_size(count));
+            stats.record_deallocation(large_size(count));
+        }
+    }
+
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Snapshot of the allocation statistics
+     * Padding is the difference between requested sizes and their size class (or page-rounded size).
+     */
+    allocator_stats_snapshot get_stats() const noexcept {
+        return stats.snapshot();
+    }
+#endif
+};
+
+
+/**
+ * @brief The small_object_std_allocator class
+ * Standard allocator adapter over small_object_allocator which can be used with STL containers and other
+ * allocator-aware types. All the copies and rebinds of an adapter share the same small_object_allocator and
+ * compare equal when they do.
+ */
+
+template<typename T>
+class small_object_std_allocator{
+
+    small_object_allocator* _alloc;
+
+    template<typename U>
+    friend class small_object_std_allocator;
+
+public:
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    /**
+     * @brief small_object_std_allocator Converting constructor
+     * @param alloc Allocator which serves the storage. It must outlive all the adapters.
+     */
+    small_object_std_allocator(small_object_allocator& alloc) noexcept : _alloc{&alloc} {}
+
+    template<typename U>
+    small_object_std_allocator(const small_object_std_allocator<U>& other) noexcept : _alloc{other._alloc} {}
+
+    /**
+     * @brief allocate Allocates the memory
+     * @param count Total number of the objects of type T for which memory has to be allocated
+     * @return Address of the allocated memory
+     */
+    T* allocate(std::size_t count){
+        if(count > std::size_t(-1) / sizeof(T))
+            throw std::bad_array_new_length();
+        return reinterpret_cast<T*>(_alloc->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief deallocate Deallocates the memory
+     * @param ptr Address of the memory to deallocate
+     * @param count Total number of objects which was passed to allocate
+     */
+    void deallocate(T* ptr, std::size_t count){
+        _alloc->deallocate(reinterpret_cast<std::byte*>(ptr), count * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator== (const small_object_std_allocator<U>& other) const noexcept {
+        return _alloc == other._alloc;
+    }
+
+    template<typename U>
+    bool operator!= (const small_object_std_allocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+
+#endif // SMALL_OBJECT_ALLOCATOR_HPP
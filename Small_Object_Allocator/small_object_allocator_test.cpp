@@ -0,0 +1,116 @@
+#include "small_object_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+int main(){
+
+    small_object_allocator alloc;
+    const std::size_t page {static_cast<std::size_t>(sysconf(_SC_PAGE_SIZE))};
+
+    {
+        // Requests map to the smallest size class which holds them
+        CHECK(alloc.usable_size(1, 1) == 8);
+        CHECK(alloc.usable_size(8, 8) == 8);
+        CHECK(alloc.usable_size(17, 8) == 24);
+        CHECK(alloc.usable_size(65) == 80);
+        CHECK(alloc.usable_size(512) == 512);
+        // The default alignment of std::max_align_t skips the classes which are only 8-byte aligned
+        CHECK(alloc.usable_size(1) == alignof(std::max_align_t));
+
+        // Classes which are not aligned enough are skipped
+        CHECK(alloc.usable_size(24, 8) == 24);
+        CHECK(alloc.usable_size(24, 16) == 32);
+        std::byte* aligned {alloc.allocate(24, 16)};
+        CHECK(reinterpret_cast<std::uintptr_t>(aligned) % 16 == 0);
+        alloc.deallocate(aligned, 24, 16);
+    }
+
+    {
+        // Large and over-aligned requests are mapped with mmap
+        CHECK(alloc.usable_size(513) == page);
+        CHECK(alloc.usable_size(page + 1) == 2 * page);
+        CHECK(alloc.usable_size(32, 2 * alignof(std::max_align_t)) == page);
+
+        std::byte* large {alloc.allocate(page + 1)};
+        CHECK(reinterpret_cast<std::uintptr_t>(large) % page == 0);
+        std::memset(large, 0xCD, 2 * page);
+        alloc.deallocate(large, page + 1);
+
+        std::byte* over_aligned {alloc.allocate(32, 64)};
+        CHECK(reinterpret_cast<std::uintptr_t>(over_aligned) % page == 0);
+        alloc.deallocate(over_aligned, 32, 64);
+
+        // Alignments beyond the page size are honoured as well
+        for(std::size_t align : {2 * page, 16 * page}){
+            std::byte* block {alloc.allocate(3 * page, align)};
+            CHECK(reinterpret_cast<std::uintptr_t>(block) % align == 0);
+            std::memset(block, 0xEF, 3 * page);
+            CHECK(test::resident_pages(block, block + 3 * page) == 3);
+            alloc.deallocate(block, 3 * page, align);
+        }
+    }
+
+    {
+        // Sizes spanning every size class as well as the large object path
+        std::vector<std::pair<std::byte*, std::size_t>> blocks;
+        for(std::size_t size = 1; size <= 2048; size += 7){
+            std::byte* ptr {alloc.allocate(size)};
+            std::memset(ptr, 0xAB, size);
+            blocks.emplace_back(ptr, size);
+        }
+        for(auto [ptr, size] : blocks){
+            CHECK(std::all_of(ptr, ptr + size, [](std::byte b){ return b == std::byte{0xAB}; }));
+            alloc.deallocate(ptr, size);
+        }
+        std::cout << "Allocated and deallocated " << blocks.size() << " blocks" << std::endl;
+    }
+
+    {
+        small_object_std_allocator<int> int_alloc {alloc};
+        std::vector<int, small_object_std_allocator<int>> vec {int_alloc};
+        for(int i=0; i<20; i++){
+            vec.push_back(i);
+        }
+
+        for(int i : vec){
+            std::cout << std::setw(2) << i << std::endl;
+        }
+        for(int i=0; i<20; i++)
+            CHECK(vec[i] == i);
+
+        // Rebound adapters share the allocator, adapters of another allocator do not compare equal
+        small_object_allocator other;
+        small_object_std_allocator<double> rebound {int_alloc};
+        CHECK(rebound == int_alloc);
+        CHECK(rebound != small_object_std_allocator<int>{other});
+        double* values {rebound.allocate(100)};
+        std::fill(values, values + 100, 1.5);
+        CHECK(values[99] == 1.5);
+        rebound.deallocate(values, 100);
+    }
+
+    {
+        using value_type = std::pair<const int, std::string>;
+        small_object_std_allocator<value_type> map_alloc {alloc};
+        std::unordered_map<int, std::string, std::hash<int>, std::equal_to<int>, small_object_std_allocator<value_type>> map {16, std::hash<int>{}, std::equal_to<int>{}, map_alloc};
+        for(int i=0; i<1000; i++){
+            map.emplace(i, std::to_string(i));
+        }
+        for(int i=0; i<1000; i+=2){
+            map.erase(i);
+        }
+        std::cout << "Map size: " << map.size() << ", map[999] = " << map.at(999) << std::endl;
+        CHECK(map.size() == 500);
+        for(int i=1; i<1000; i+=2)
+            CHECK(map.at(i) == std::to_string(i));
+        CHECK(map.count(998) == 0);
+    }
+    return test::exit_code();
+}
@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <cstdio>
 #include <new>
+#include <type_traits>
 #include "static_buffer_arena.hpp"
 
 ///
@@ -19,7 +20,11 @@
 template<typename T, std::size_t elements>
 class stack_allocator{
 
-    static arena<elements * sizeof(T)> _ar;
+    // Every element takes a whole arena block, over-aligned types may also leave an alignment gap before it
+    constexpr static std::size_t alignment_slack {alignof(T) > arena_granularity ? alignof(T) + arena_min_block_size : 0};
+    constexpr static std::size_t arena_size {elements * (arena_block_size(sizeof(T)) + alignment_slack)};
+
+    static arena<arena_size> _ar;
 
 public:
 
@@ -71,6 +76,15 @@ public:
 	        _ar.deallocate(reinterpret_cast<std::byte*>(ptr));
     }
 
+#ifdef ALLOCATOR_STATS
+    /**
+     * @brief get_stats Statistics of the arena shared by all the allocators with the same template arguments
+     */
+    static allocator_stats_snapshot get_stats() noexcept {
+        return _ar.get_stats();
+    }
+#endif
+
     /**
      * @brief construct Constructs an object of type T with given arguments at address ptr
      * @param ptr Address to be used for construction of object
@@ -91,7 +105,101 @@ public:
 };
 
 template<class T, std::size_t count>
-arena<count * sizeof(T)> stack_allocator<T, count>::_ar{};
+arena<stack_allocator<T, count>::arena_size> stack_allocator<T, count>::_ar;
+
+
+
+///
+/// \brief The stateful_stack_allocator class
+/// Stateful counterpart of stack_allocator. Instead of one static arena shared by every instance with the
+/// same template arguments, each allocator refers to an arena owned by the user, so that every container
+/// or request can have its own arena. The arena size is given in bytes, rebinding the allocator to another
+/// type (e.g. the node type of a container) keeps using the same arena. Two allocators compare equal if and
+/// only if they use the same arena. The allocator propagates with the container on copy assignment, move
+/// assignment and swap, so memory is always released to the arena it was allocated from.
+///
+
+template<typename T, std::size_t bytes>
+class stateful_stack_allocator{
+
+    arena<bytes>* _ar;
+
+    template<typename U, std::size_t other_bytes>
+    friend class stateful_stack_allocator;
+
+public:
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    template<typename U>
+    struct rebind{
+        using other = stateful_stack_allocator<U, bytes>;
+    };
+
+    /**
+     * @brief stateful_stack_allocator Converting constructor
+     * @param ar Arena to allocate from. It must outlive every allocator and container using it.
+     */
+    stateful_stack_allocator(arena<bytes>& ar) noexcept : _ar{&ar} {}
+
+    /**
+     * @brief stateful_stack_allocator Copy constructor is defaulted, the copy shares the arena
+     */
+    stateful_stack_allocator(const stateful_stack_allocator&) = default;
+
+    /**
+     * @brief operator = Copy assignment operator is defaulted
+     * @return
+     */
+    stateful_stack_allocator& operator=(const stateful_stack_allocator&) = default;
+
+    /**
+     * @brief stateful_stack_allocator Rebinding constructor, the new allocator shares the arena
+     */
+    template<typename U>
+    stateful_stack_allocator(const stateful_stack_allocator<U, bytes>& other) noexcept : _ar{other._ar} {}
+
+    /**
+     * @brief allocate Allocates the memory
+     * @param count Total number of the objects of type T for which memory has to be allocated
+     * @return Address of the allocated memory
+     */
+    T* allocate(std::size_t count){
+        if(count > std::size_t(-1) / sizeof(T))
+            throw std::bad_array_new_length();
+        return reinterpret_cast<T*>(_ar->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief deallocate Deallocates the memory
+     * @param ptr Ptr to an address of the object for which memory has to be deallocated
+     * @param count Total number of objects to deallocate
+     */
+    void deallocate(T* ptr, [[maybe_unused]] std::size_t count){
+        if(ptr)
+            _ar->deallocate(reinterpret_cast<std::byte*>(ptr));
+    }
+
+#ifdef ALLOCATOR_STATS
+    allocator_stats_snapshot get_stats() const noexcept {
+        return _ar->get_stats();
+    }
+#endif
+
+    template<typename U>
+    bool operator== (const stateful_stack_allocator<U, bytes>& other) const noexcept {
+        return _ar == other._ar;
+    }
+
+    template<typename U>
+    bool operator!= (const stateful_stack_allocator<U, bytes>& other) const noexcept {
+        return !(*this == other);
+    }
+};
 
 
 #endif // GENERAL_ALLOC_HPP
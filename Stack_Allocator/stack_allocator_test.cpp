@@ -1,4 +1,5 @@
 #include "stack_allocator.hpp"
+#include "test_common.hpp"
 #include <vector>
 #include <iostream>
 #include <iomanip>
@@ -36,5 +37,25 @@ int main(){
             std::cout << std::setw(2) << i << std::endl;
         }
     }
-    return 0;
+
+    {
+        // The arena holds as many single element allocations as the allocator is sized for
+        stack_allocator<int, 10> small;
+        int* ints[10];
+        for(int*& ptr : ints)
+            ptr = small.allocate(1);
+        for(int* ptr : ints)
+            small.deallocate(ptr, 1);
+
+        struct alignas(64) line{ char bytes[64]; };
+        stack_allocator<line, 10> aligned;
+        line* lines[10];
+        for(line*& ptr : lines){
+            ptr = aligned.allocate(1);
+            CHECK(reinterpret_cast<std::uintptr_t>(ptr) % alignof(line) == 0);
+        }
+        for(line* ptr : lines)
+            aligned.deallocate(ptr, 1);
+    }
+    return test::exit_code();
 }
@@ -0,0 +1,96 @@
+#include "stack_allocator.hpp"
+#include "test_common.hpp"
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <list>
+#include <thread>
+
+int main(){
+
+
+    arena<4096> first_arena;
+    arena<4096> second_arena;
+
+    stateful_stack_allocator<int, 4096> first_alloc {first_arena};
+    stateful_stack_allocator<int, 4096> second_alloc {second_arena};
+
+    std::cout << std::boolalpha;
+    std::cout << "Allocators on different arenas compare equal: " << (first_alloc == second_alloc) << std::endl;
+    CHECK(first_alloc != second_alloc);
+    CHECK((first_alloc == stateful_stack_allocator<double, 4096>(first_arena)));
+
+    {
+        std::vector<int, stateful_stack_allocator<int, 4096>> vec {first_alloc};
+        for(int i=0; i<20; i++){
+            vec.push_back(i);
+        }
+
+        // Move assignment propagates the allocator, the elements stay in the first arena
+        std::vector<int, stateful_stack_allocator<int, 4096>> other {second_alloc};
+        other = std::move(vec);
+        std::cout << "Moved-to vector uses first arena: " << (other.get_allocator() == first_alloc) << std::endl;
+        CHECK(other.get_allocator() == first_alloc);
+        CHECK(first_arena.owns(other.data()));
+
+        // Copy assignment and swap propagate the allocator as well
+        std::vector<int, stateful_stack_allocator<int, 4096>> copy {second_alloc};
+        copy = other;
+        CHECK(copy.get_allocator() == first_alloc);
+        CHECK(first_arena.owns(copy.data()) && copy.data() != other.data());
+        std::vector<int, stateful_stack_allocator<int, 4096>> swapped {10, 7, second_alloc};
+        swapped.swap(copy);
+        CHECK(swapped.get_allocator() == first_alloc && copy.get_allocator() == second_alloc);
+        CHECK(first_arena.owns(swapped.data()) && second_arena.owns(copy.data()));
+        CHECK(copy.size() == 10 && copy[9] == 7);
+
+        for(int i : other){
+            std::cout << std::setw(2) << i << std::endl;
+        }
+        for(int i=0; i<20; i++)
+            CHECK(other[i] == i && swapped[i] == i);
+    }
+
+    {
+        // The list rebinds the allocator to its node type, the nodes come from the same arena
+        std::list<int, stateful_stack_allocator<int, 4096>> lst{second_alloc};
+        for(int i=0; i<5; i++){
+            lst.push_back(i);
+        }
+        lst.resize(7, 45);
+        stateful_stack_allocator<double, 4096> rebound {lst.get_allocator()};
+        std::cout << "Rebound allocator uses second arena: " << (rebound == second_alloc) << std::endl;
+        CHECK(rebound == second_alloc);
+        CHECK(rebound != first_alloc);
+        CHECK(std::all_of(lst.begin(), lst.end(), [&](const int& i){ return second_arena.owns(&i) && !first_arena.owns(&i); }));
+        CHECK(lst.size() == 7 && lst.back() == 45);
+        for(int i : lst){
+            std::cout << std::setw(2) << i << std::endl;
+        }
+    }
+
+    {
+        // Independent containers on independent arenas can be used from different threads
+        bool worker_ok {false};
+        std::thread worker {[&](){
+            std::vector<int, stateful_stack_allocator<int, 4096>> vec {first_alloc};
+            for(int i=0; i<100; i++){
+                vec.push_back(i);
+            }
+            worker_ok = first_arena.owns(vec.data()) && vec[99] == 99;
+        }};
+        std::vector<int, stateful_stack_allocator<int, 4096>> vec {second_alloc};
+        for(int i=0; i<100; i++){
+            vec.push_back(i);
+        }
+        worker.join();
+        CHECK(worker_ok);
+        CHECK(second_arena.owns(vec.data()) && vec[99] == 99);
+    }
+
+    // Every container released its memory to the arena it was allocated from
+    CHECK(first_arena.get_occupied_bytes() == 0);
+    CHECK(second_arena.get_occupied_bytes() == 0);
+    return test::exit_code();
+}